@@ -1,3 +1,8 @@
-stty -F /dev/ttyACM1 115200 cs8 -parenb -cstopb
+# Follows every attached LaunchPad, logs go to ./logs split per chip ID
+# The eZ-FET of each LaunchPad enumerates two CDC ports, interface 00 is
+# the debugger and interface 02 the application UART. The by-id names
+# carry the eZ-FET serial number, so a board keeps its path when it
+# re-enumerates on a different ttyACM number.
+make -C tools capture/capture || exit 1
 echo "Press ctl + c to quit"
-cat /dev/ttyACM1 | tee log.txt
+tools/capture/capture -e -o logs '/dev/serial/by-id/usb-Texas_Instruments_MSP_Tools_Driver_*-if02'
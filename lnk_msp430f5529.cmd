@@ -63,7 +63,8 @@ MEMORY
     INFOC                   : origin = 0x1880, length = 0x0080
     INFOD                   : origin = 0x1800, length = 0x0080
     FLASH                   : origin = 0x4400, length = 0xBB80
-    FLASH2                  : origin = 0x10000,length = 0x143F8 /* Boundaries changed to fix CPU47 */
+    FLASH2                  : origin = 0x10000,length = 0x8400  /* Ends before LOGFLASH, keeps code out of bank D */
+    LOGFLASH                : origin = 0x18400,length = 0x4000  /* Results log, see src/results_log.h */
     INT00                   : origin = 0xFF80, length = 0x0002
     INT01                   : origin = 0xFF82, length = 0x0002
     INT02                   : origin = 0xFF84, length = 0x0002
@@ -145,6 +146,8 @@ SECTIONS
     .f_word_partial_write_10 : {} > FLASH
     .f_word_partial_write_12 : {} > FLASH
     .f_block_set : {} > FLASH
+    .rd_hammer_word : {} > FLASH
+    .rd_hammer_segment : {} > FLASH
 
     .bss        : {} > RAM                  /* Global & static vars              */
     .data       : {} > RAM                  /* Global & static vars              */
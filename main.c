@@ -13,11 +13,40 @@
 *     atleast once in 11 reads.
 *  - partial_write_latency is the minimum successful write time of the first
 *     word in a segment
+*  - program threshold is the number of partial write pulses each bit of
+*     the segment needed to be programmed, as a histogram
+*  - erase threshold is the number of 1ms partial erase pulses each bit
+*     of the segment needed to be erased, as a histogram
+*  - The stress loop verifies every segment each VERIFY_INTERVAL cycles,
+*     the first cycle a segment fails is reported at the next checkpoint
+*  - The time of one PE cycle and of one verify cycle is printed before
+*     the loop, to check the verify overhead of VERIFY_INTERVAL
+*  - ecc is the number of codewords of the voted segment that a SECDED
+*     code would leave clean, correct, detect or miscorrect, for the
+*     (22,16) and (39,32) codes, see src/flash_ecc.h
+*  - Flash controller anomalies are printed as #FT lines at every
+*     checkpoint, see src/flash_trace.h
+*  - Commands received over serial can pause stressing, request
+*     statistics of a segment range and change what is measured, see
+*     src/command.h
+*  - The raw image of bank D is streamed out by DMA at every checkpoint
+*     as binary frames, see src/raw_dump.h
+*  - EXPERIMENT_READ_DISTURB replaces PE stress with read hammering of a
+*     few segments, see src/read_disturb.h
+*  - Every segment's statistics are also appended to the results log in
+*     bank C, which is dumped over serial at boot
 ****************************************************************/
 #include <msp430.h> 
 #include "src/flash_operations.h"
 #include "src/flash_statistics.h"
 #include "src/Serial.h"
+#include "src/results_log.h"
+#include "src/raw_dump.h"
+#include "src/read_disturb.h"
+#include "src/command.h"
+#include "src/flash_trace.h"
+#include "src/flash_ecc.h"
+#include "src/event_timer.h"
 #include <stdint.h>
 #include <stdlib.h>
 #include <stdio.h>
@@ -29,119 +58,349 @@
 #define TOTAL_PE_CYCLES       2000000 
 #define STAT_INCREMENT_CYCLES 200000 // number of PE cycles to stress between stats
 #define STRESS_INDICATOR_CYCLES 25000
+#define STRESS_POLL_CYCLES    1 // commands are handled between bursts this long,
+                                // a bank PE cycle takes ~0.4-0.7 s
+#define VERIFY_INTERVAL       8 // PE cycles between verifies, a verify cycle reads
+                                // the bank twice at ~63 ms each, ~0.2-0.35 of a
+                                // stress cycle, so every 8th adds ~3%. The cost
+                                // measured on target is printed before the loop
+
+#define DEFAULT_MEASURE       CMD_MEASURE_ALL // see command.h, changed with 'm'
+
+#define EXPERIMENT_READ_DISTURB 0 // 1 runs the read disturb experiment instead
+#define RD_FIRST_SEGMENT      0
+#define RD_N_SEGMENTS         4
+#define RD_WORD_MODE          1 // 1 hammers only the first word of each segment
+#define RD_PATTERN            0x0000 // programmed before hammering
+#define RD_TOTAL_READS        400000000 // reads of every hammered word
+#define RD_CHECK_READS        40000000 // reads of every word between statistics
+// word mode reads ~400k times a second, the defaults take ~1.2 hours
+// segment mode reads all 256 words, the same dose takes ~12 days
 
 #define BUF_SIZE              64
+#define STRESS_ERROR          "#ERR stress routine could not be allocated, stopped\n"
 
 void init_and_wait(void);
 uint64_t get_chipID(void);
+void run_statistics(f_bank_t bank, uint32_t cycles, uint16_t first, uint16_t last);
+void run_read_disturb(f_bank_t bank);
+void print_threshold(char* label, fs_threshold_s* hist);
+void report_failures(void);
+uint8_t report_verify_cost(f_bank_t bank);
+void print_ecc(uint8_t code);
 
+static char outputBuffer[BUF_SIZE]; // shared, the 160 byte stack is too small for two
+static cmd_state_s cmd; // requests received over Serial0
+static fs_threshold_s threshold; // static, 34 bytes each
+static fs_threshold_s erase_threshold;
+static f_fail_table_s fails; // first failed verify of every bank D segment
+static uint64_t fails_reported; // one bit per segment
+static uint16_t voted_image[F_SEGMENT_N_BYTES / 2]; // segment as voted, for ecc
 
 int main(void)
 {
-  char outputBuffer[BUF_SIZE];
   f_bank_t bank_D = (void*)F5529_FLASH_BANK_D;
-  f_segment_t seg;
-  fs_stats_s stats;
+  uint32_t last_checkpoint;
 
   WDTCTL = WDTPW + WDTHOLD;	// stop watchdog timer
-  init_and_wait(); // holds program until user presses KEY1
-
   Serial0_setup();
+  ft_init(); // before the first flash operation
+
+  rl_init();
+  rl_dump(); // results of previous runs, in case the host missed them
+
+  init_and_wait(); // holds program until user presses KEY1
+  rl_log_session(get_chipID());
 
   /* PRINT HEADER */
   Serial0_write("-------------------------------------------------------\n");
   Serial0_write("- Experiment 01\n");
+#if EXPERIMENT_READ_DISTURB
+  Serial0_write("- Purpose: Get statistics as flash is disturbed by reads\n");
+#else
   Serial0_write("- Purpose: Get statistics as flash wears to 2M cycles\n");
+#endif
   sprintf(outputBuffer, "- Subject Chip ID: 0x%08llX\n", get_chipID());
   Serial0_write(outputBuffer);
   Serial0_write("-------------------------------------------------------\n");
 
-  /* INITIAL STATISTICS */
-  // print out number of cycles
-  Serial0_write("\nCycle count: 0\n\n");
+#if EXPERIMENT_READ_DISTURB
+  run_read_disturb(bank_D);
+  return 0;
+#endif
 
-  seg = (f_segment_t)bank_D; // set to base segment
+  cmd.total_cycles = TOTAL_PE_CYCLES;
+  cmd.increment_cycles = STAT_INCREMENT_CYCLES;
+  cmd.measure = DEFAULT_MEASURE;
+  cmd.first_segment = 0;
+  cmd.last_segment = F_BANK_N_SEGMENTS - 1;
+  Serial0_enable_rx();
+  f_fail_table_init(&fails, 0);
 
-  // do statistics on every segment
-  for(uint16_t s = 0 ; s < F_BANK_N_SEGMENTS; s++){
-    sprintf(outputBuffer, "  Segment # %u Statistics\n", s);
-    Serial0_write(outputBuffer);
+  /* INITIAL STATISTICS */
+  run_statistics(bank_D, 0, cmd.first_segment, cmd.last_segment);
+  last_checkpoint = 0;
+  if(!report_verify_cost(bank_D)){ // runs the first PE cycle
+    Serial0_write(STRESS_ERROR);
+    return 1;
+  }
 
-    fs_check_bit_values(seg, &stats, 0x0000); // ~4 seconds!
-    f_segment_erase((uint16_t*)seg); // prepare segment for partial write testing
-    fs_get_partial_write_stats((uint16_t*)seg, &stats, 0x0000);
-    fs_get_partial_erase_stats(seg, &stats);
 
-    sprintf(outputBuffer, "    incorrect bit count   : %u\n", stats.incorrect_bit_count);
-    Serial0_write(outputBuffer);
-    sprintf(outputBuffer, "    unstable bit count    : %u\n", stats.unstable_bit_count);
-    Serial0_write(outputBuffer);
-    sprintf(outputBuffer, "    partial write latency : %u\n", stats.partial_write_latency);
-    Serial0_write(outputBuffer);
-    sprintf(outputBuffer, "    partial erase latency : %u\n", stats.partial_erase_latency);
-    Serial0_write(outputBuffer);
+  /* MAIN LOOP */
+  while(cmd.cycles < cmd.total_cycles){
+    cmd_poll(&cmd);
 
-    seg++;
-  }
+    if(cmd.dump_requested){
+      cmd.dump_requested = 0;
+      rl_dump();
+    }
+    if(cmd.stats_requested){
+      cmd.stats_requested = 0;
+      run_statistics(bank_D, cmd.cycles, cmd.request_first, cmd.request_last);
+      continue;
+    }
+    if(cmd.paused){
+      Serial0_wait_line(); // sleep until the next command
+      continue;
+    }
 
+    if(!f_stress_bank_verified(bank_D, 0x0000, STRESS_POLL_CYCLES, &fails, VERIFY_INTERVAL)){
+      Serial0_write(STRESS_ERROR); // no cycles ran, none are counted
+      return 1;
+    }
+    /* 0x0000 indicates 100% flash bit wear
+       f_stress_bank_verified will return with all words written to 0x0000 */
+    cmd.cycles += STRESS_POLL_CYCLES;
 
-  /* MAIN LOOP */
-  for(uint32_t i = 0; i < TOTAL_PE_CYCLES / STAT_INCREMENT_CYCLES; i++){
-
-    // stress bank by STAT_INCREMENT
-    for(uint32_t s = 0; s < STAT_INCREMENT_CYCLES/STRESS_INDICATOR_CYCLES; s++){
-      f_stress_bank(bank_D, 0x0000, STRESS_INDICATOR_CYCLES);
-      /* 0x0000 indicates 100% flash bit wear
-         f_stress_bank will return with all words written to 0x0000 */
-      sprintf(outputBuffer, "\nSTRESSING SEGMENTS (%lu)\n",
-              (uint32_t)(i + s));
+    if(cmd.cycles % STRESS_INDICATOR_CYCLES == 0){
+      sprintf(outputBuffer, "\nSTRESSING SEGMENTS (%lu)\n", cmd.cycles);
       Serial0_write(outputBuffer);
     }
 
-    // print out number of cycles so far
-    sprintf(outputBuffer, "\nCycle count: %lu\n\n", (uint32_t)((i + 1) * STAT_INCREMENT_CYCLES));
-    Serial0_write(outputBuffer);
+    if(cmd.cycles - last_checkpoint >= cmd.increment_cycles){
+      report_failures();
+      run_statistics(bank_D, cmd.cycles, cmd.first_segment, cmd.last_segment);
+      last_checkpoint = cmd.cycles;
+    }
+  }
 
-    seg = (f_segment_t)bank_D; // set to base segment
+  report_failures();
+  if(last_checkpoint != cmd.cycles) // increment changed to one that does not divide the total
+    run_statistics(bank_D, cmd.cycles, cmd.first_segment, cmd.last_segment);
 
-    // do statistics on every segment
-    for(uint16_t s = 0 ; s < F_BANK_N_SEGMENTS; s++){
-      sprintf(outputBuffer, "  Segment # %u Statistics\n", s);
-      Serial0_write(outputBuffer);
+  return 0;
+
+}
 
-      fs_check_bit_values(seg, &stats, 0x0000); // ~4 seconds!
+void init_and_wait(void)
+{
+  P1REN |= BIT1;
+  P1DIR |= BIT0;
+  P1OUT |= BIT1 + BIT0;
+  while(P1IN & BIT1);// wait till button press to start
+  P1OUT &= ~BIT0;
+}
+
+uint64_t get_chipID(void)
+{
+  return *(uint64_t*)CHIP_ID_ADR;
+}
+
+void run_statistics(f_bank_t bank, uint32_t cycles, uint16_t first, uint16_t last)
+// prints statistics of segments first to last and appends them to the
+// results log, cmd.measure selects the measurements
+// fields that are not measured are left at 0xFFFF
+{
+  f_segment_t seg;
+  fs_stats_s stats;
+
+  // print out number of cycles so far
+  sprintf(outputBuffer, "\nCycle count: %lu\n\n", cycles);
+  Serial0_write(outputBuffer);
+  ft_drain(); // flash controller anomalies since the last checkpoint
+
+  seg = (f_segment_t)bank + first;
+
+  if(cmd.measure & CMD_MEASURE_RAW_DUMP)
+    raw_dump_start(bank, cycles); // ~3 seconds, overlaps the first bit check
+
+  for(uint16_t s = first; s <= last; s++){
+    stats.incorrect_bit_count = 0xFFFF;
+    stats.unstable_bit_count = 0xFFFF;
+    stats.partial_write_latency = FS_PARTIAL_WRITE_FAIL;
+    stats.partial_erase_latency = FS_PARTIAL_ERASE_FAIL;
+
+    if(cmd.measure & (CMD_MEASURE_BIT_VALUES + CMD_MEASURE_ECC))
+      fs_check_bit_values_voted(seg, &stats, 0x0000, voted_image); // ~4 seconds!
+
+    raw_dump_wait(); // serial port and bank are busy until the dump is done
+    sprintf(outputBuffer, "  Segment # %u Statistics\n", s);
+    Serial0_write(outputBuffer);
+
+    if(cmd.measure & (CMD_MEASURE_PARTIAL_WRITE + CMD_MEASURE_PARTIAL_ERASE +
+                      CMD_MEASURE_PROGRAM_THRESHOLD + CMD_MEASURE_ERASE_THRESHOLD)){
+      __disable_interrupt(); // keep the timed pulses exact, RX bytes may drop
       f_segment_erase((uint16_t*)seg); // prepare segment for partial write testing
-      fs_get_partial_write_stats((uint16_t*)seg, &stats, 0x0000);
-      fs_get_partial_erase_stats(seg, &stats);
+      if(cmd.measure & CMD_MEASURE_PARTIAL_WRITE)
+        fs_get_partial_write_stats((uint16_t*)seg, &stats, 0x0000);
+      if(cmd.measure & CMD_MEASURE_PARTIAL_ERASE)
+        fs_get_partial_erase_stats(seg, &stats);
+      if(cmd.measure & CMD_MEASURE_PROGRAM_THRESHOLD)
+        fs_get_program_threshold_stats(seg, &threshold, 0x0000);
+      if(cmd.measure & CMD_MEASURE_ERASE_THRESHOLD)
+        fs_get_erase_threshold_stats(seg, &erase_threshold);
+      __enable_interrupt();
+    }
 
+    if(cmd.measure & CMD_MEASURE_BIT_VALUES){
       sprintf(outputBuffer, "    incorrect bit count   : %u\n", stats.incorrect_bit_count);
       Serial0_write(outputBuffer);
       sprintf(outputBuffer, "    unstable bit count    : %u\n", stats.unstable_bit_count);
       Serial0_write(outputBuffer);
+    }
+    if(cmd.measure & CMD_MEASURE_PARTIAL_WRITE){
       sprintf(outputBuffer, "    partial write latency : %u\n", stats.partial_write_latency);
       Serial0_write(outputBuffer);
+    }
+    if(cmd.measure & CMD_MEASURE_PARTIAL_ERASE){
       sprintf(outputBuffer, "    partial erase latency : %u\n", stats.partial_erase_latency);
       Serial0_write(outputBuffer);
-
-      seg++;
     }
+    if(cmd.measure & CMD_MEASURE_PROGRAM_THRESHOLD)
+      print_threshold("    program threshold     :", &threshold);
+    if(cmd.measure & CMD_MEASURE_ERASE_THRESHOLD)
+      print_threshold("    erase threshold       :", &erase_threshold);
+    if(cmd.measure & CMD_MEASURE_ECC){
+      print_ecc(ECC_CODE_22_16);
+      print_ecc(ECC_CODE_39_32);
+    }
+
+    rl_log_stats(cycles, s, &stats);
+
+    cmd_poll(&cmd); // queries are answered between segments
+    seg++;
   }
+}
 
-  return 0;
+void print_threshold(char* label, fs_threshold_s* hist)
+// prints the histogram bins on one line, the last bin never flipped
+{
+  Serial0_write(label);
+  for(uint8_t p = 0; p <= FS_PT_MAX_PULSES; p++){
+    sprintf(outputBuffer, " %u", hist->pulses[p]);
+    Serial0_write(outputBuffer);
+  }
+  Serial0_write("\n");
+}
+
+uint8_t report_verify_cost(f_bank_t bank)
+// times one unverified PE cycle of the bank and the two bank reads of a
+// verify cycle with ACLK, both are well under the 2 s the timer spans
+// returns 0 if the PE cycle could not run
+{
+  uint16_t stress, verify;
+  f_segment_t target;
+
+  SLOW_EVENT_TIMER_START;
+  if(!f_stress_bank_verified(bank, 0x0000, 1, &fails, 0))
+    return 0;
+  stress = TA0R;
+  TA0CTL &= ~MC_3; // halt timer
+  cmd.cycles++;
 
+  target = (f_segment_t)bank;
+  SLOW_EVENT_TIMER_START;
+  for(uint8_t s = 0; s < F_BANK_N_SEGMENTS; s++, target++){
+    f_segment_verify(target, 0xFFFF); // fails after programming, same reads
+    f_segment_verify(target, 0x0000);
+  }
+  verify = TA0R;
+  TA0CTL &= ~MC_3; // halt timer
+
+  sprintf(outputBuffer, "Verify cost (ACLK): stress %u, verify %u\n", stress, verify);
+  Serial0_write(outputBuffer);
+  // smallest interval that keeps verifying under 3% of the stress time
+  sprintf(outputBuffer, "Interval for 3%%: %lu, using %u\n",
+          ((uint32_t)verify * 100 + 3UL * stress - 1) / (3UL * stress), VERIFY_INTERVAL);
+  Serial0_write(outputBuffer);
+  return 1;
 }
 
-void init_and_wait(void)
+void print_ecc(uint8_t code)
+// codewords of the voted image that are clean, corrected, detected and
+// miscorrected under code
 {
-  P1REN |= BIT1;
-  P1DIR |= BIT0;
-  P1OUT |= BIT1 + BIT0;
-  while(P1IN & BIT1);// wait till button press to start
-  P1OUT &= ~BIT0;
+  ecc_result_s result;
+
+  ecc_evaluate(voted_image, 0x0000, code, &result);
+  sprintf(outputBuffer, "    ecc (%u,%u)           : %u ok %u cor %u det %u mis\n",
+          ecc_codeword_bits(code), ecc_data_bits(code), result.clean,
+          result.corrected, result.detected, result.miscorrected);
+  Serial0_write(outputBuffer);
 }
 
-uint64_t get_chipID(void)
+void report_failures(void)
+// prints and logs segments that failed a verify since the last report
 {
-  return *(uint64_t*)CHIP_ID_ADR;
+  for(uint8_t s = 0; s < F_BANK_N_SEGMENTS; s++){
+    if(fails.first_fail[s] == F_FAIL_NONE || (fails_reported & ((uint64_t)1 << s)))
+      continue;
+    fails_reported |= (uint64_t)1 << s;
+
+    sprintf(outputBuffer, "#FAIL %u %lu\n", s, fails.first_fail[s]); // segment, cycle
+    Serial0_write(outputBuffer);
+    rl_log_failure(fails.first_fail[s], s);
+  }
 }
 
+void run_read_disturb(f_bank_t bank)
+// programs RD_N_SEGMENTS segments to RD_PATTERN then reads them over and
+// over, gathering statistics every RD_CHECK_READS reads of each word
+// read counts are per word in both modes so the doses compare
+{
+  f_segment_t seg = (f_segment_t)bank + RD_FIRST_SEGMENT;
+  static rd_result_s result[RD_N_SEGMENTS]; // too big for the stack
+  fs_stats_s stats;
+
+  for(uint16_t s = 0; s < RD_N_SEGMENTS; s++){
+    if(!f_stress_segment(seg + s, RD_PATTERN, 1)){ // one erase and program
+      Serial0_write(STRESS_ERROR);
+      return;
+    }
+  }
+
+  for(uint32_t reads = 0; reads <= RD_TOTAL_READS; reads += RD_CHECK_READS){
+
+    if(reads){
+      for(uint16_t s = 0; s < RD_N_SEGMENTS; s++){
+#if RD_WORD_MODE
+        rd_disturb_word((uint16_t*)(seg + s), RD_CHECK_READS, &result[s]);
+#else
+        rd_disturb_segment(seg + s, RD_CHECK_READS, &result[s]);
+#endif
+      }
+    }
+
+    sprintf(outputBuffer, "\nRead count per word: %lu\n\n", reads);
+    Serial0_write(outputBuffer);
+    ft_drain();
+
+    for(uint16_t s = 0; s < RD_N_SEGMENTS; s++){
+      fs_check_bit_values(seg + s, &stats, RD_PATTERN);
+
+      sprintf(outputBuffer, "  Segment # %u Statistics\n", RD_FIRST_SEGMENT + s);
+      Serial0_write(outputBuffer);
+      sprintf(outputBuffer, "    incorrect bit count   : %u\n", stats.incorrect_bit_count);
+      Serial0_write(outputBuffer);
+      sprintf(outputBuffer, "    unstable bit count    : %u\n", stats.unstable_bit_count);
+      Serial0_write(outputBuffer);
+      sprintf(outputBuffer, "    word reads per second : %lu\n", rd_reads_per_second(&result[s]));
+      Serial0_write(outputBuffer);
+#if !RD_WORD_MODE
+      sprintf(outputBuffer, "    flash reads per second: %lu\n",
+              rd_reads_per_second(&result[s]) * RD_SEGMENT_READS_PER_ITERATION);
+      Serial0_write(outputBuffer);
+#endif
+    }
+  }
+}
@@ -29,3 +29,64 @@ void Serial0_put(char targetByte)
   while(!(UCA1IFG & UCTXIFG));
   UCA1TXBUF = targetByte;
 }
+
+static char rx_buffer[SERIAL0_LINE_SIZE];
+static char rx_line[SERIAL0_LINE_SIZE];
+static uint8_t rx_length = 0;
+static volatile uint8_t rx_line_ready = 0;
+
+void Serial0_enable_rx(void)
+{
+  UCA1IFG &= ~UCRXIFG;
+  UCA1IE |= UCRXIE;
+  __enable_interrupt();
+}
+
+uint8_t Serial0_get_line(char* dst)
+{
+  if(!rx_line_ready)
+    return 0;
+
+  for(uint8_t i = 0; i < SERIAL0_LINE_SIZE; i++)
+    dst[i] = rx_line[i];
+  rx_line_ready = 0;
+
+  return 1;
+}
+
+void Serial0_wait_line(void)
+{
+  __disable_interrupt(); // LPM0 must be entered before the line arrives
+  while(!rx_line_ready){
+    __bis_SR_register(LPM0_bits + GIE);
+    __disable_interrupt();
+  }
+  __enable_interrupt();
+}
+
+#pragma vector=USCI_A1_VECTOR
+__interrupt void Serial0_rx_isr(void)
+{
+  char c;
+
+  switch(__even_in_range(UCA1IV, 4)){
+    case 2: // UCRXIFG
+      c = UCA1RXBUF;
+      if(c == '\r' || c == '\n'){
+        if(rx_length && !rx_line_ready){ // a line not yet taken is kept
+          for(uint8_t i = 0; i < rx_length; i++)
+            rx_line[i] = rx_buffer[i];
+          rx_line[rx_length] = '\0';
+          rx_line_ready = 1;
+          __bic_SR_register_on_exit(LPM0_bits);
+        }
+        rx_length = 0;
+      }
+      else if(rx_length < SERIAL0_LINE_SIZE - 1){
+        rx_buffer[rx_length++] = c;
+      }
+      break;
+    default:
+      break;
+  }
+}
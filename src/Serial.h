@@ -1,8 +1,21 @@
 #pragma once
 #include <msp430.h>
+#include <stdint.h>
+
+#define SERIAL0_LINE_SIZE 32 // longest received line, longer lines are cut
 
 void Serial0_setup(void);
 
 void Serial0_write(char* targetPtr);
 
 void Serial0_put(char targetByte);
+
+void Serial0_enable_rx(void);
+// received bytes are collected into lines by the USCI_A1 interrupt
+
+uint8_t Serial0_get_line(char* dst);
+// copies a completed line into dst (SERIAL0_LINE_SIZE bytes), returns 0
+// when no line is waiting
+
+void Serial0_wait_line(void);
+// sleeps in LPM0 until a completed line is waiting
@@ -0,0 +1,113 @@
+#include "command.h"
+#include <msp430.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "Serial.h"
+#include "flash_operations.h"
+
+static char cmd_line[SERIAL0_LINE_SIZE];
+static char cmd_reply[64];
+
+
+static uint8_t cmd_get_range(char* args, uint16_t* first, uint16_t* last)
+// parses "A B", returns 0 if the range is not inside a bank
+{
+  char* end;
+  unsigned long a = strtoul(args, &end, 10);
+  unsigned long b;
+
+  if(end == args)
+    return 0;
+  args = end;
+  b = strtoul(args, &end, 10);
+  if(end == args)
+    b = a; // single segment
+
+  if(a > b || b >= F_BANK_N_SEGMENTS)
+    return 0;
+
+  *first = a;
+  *last = b;
+  return 1;
+}
+
+void cmd_poll(cmd_state_s* state)
+{
+  char* args;
+  char* end;
+  unsigned long value;
+
+  if(!Serial0_get_line(cmd_line))
+    return;
+
+  args = cmd_line + 1;
+
+  switch(cmd_line[0]){
+    case 'p':
+      state->paused = 1;
+      Serial0_write("#OK paused\n");
+      break;
+
+    case 'r':
+      state->paused = 0;
+      Serial0_write("#OK resumed\n");
+      break;
+
+    case 's':
+      if(!cmd_get_range(args, &state->request_first, &state->request_last)){
+        Serial0_write("#ERR s FIRST LAST\n");
+        break;
+      }
+      state->stats_requested = 1;
+      Serial0_write("#OK statistics requested\n");
+      break;
+
+    case 'g':
+      if(!cmd_get_range(args, &state->first_segment, &state->last_segment)){
+        Serial0_write("#ERR g FIRST LAST\n");
+        break;
+      }
+      Serial0_write("#OK checkpoint segments set\n");
+      break;
+
+    case 'm':
+      value = strtoul(args, &end, 16);
+      if(end == args || value & ~CMD_MEASURE_ALL){
+        Serial0_write("#ERR m MASK\n");
+        break;
+      }
+      state->measure = value;
+      Serial0_write("#OK measurements set\n");
+      break;
+
+    case 'i':
+      value = strtoul(args, &end, 10);
+      if(end == args || value == 0){
+        Serial0_write("#ERR i CYCLES\n");
+        break;
+      }
+      state->increment_cycles = value;
+      Serial0_write("#OK checkpoint increment set\n");
+      break;
+
+    case 'q':
+      sprintf(cmd_reply, "#PROGRESS %lu/%lu every %lu %s\n", state->cycles,
+              state->total_cycles, state->increment_cycles,
+              state->paused ? "paused" : "running");
+      Serial0_write(cmd_reply);
+      sprintf(cmd_reply, "#SEGMENTS %u-%u MEASURE %X\n", state->first_segment,
+              state->last_segment, state->measure);
+      Serial0_write(cmd_reply);
+      break;
+
+    case 'd':
+      state->dump_requested = 1;
+      Serial0_write("#OK dump requested\n");
+      break;
+
+    default:
+      Serial0_write("#ERR commands: p r s g m i q d\n");
+      break;
+  }
+}
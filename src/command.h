@@ -0,0 +1,53 @@
+#pragma once
+#include <msp430.h>
+#include <stdint.h>
+
+//-------------------------------------------------------------------//
+// command.h
+//-------------------------------------------------------------------//
+// Parser for commands received over Serial0 while an experiment runs.
+// One command per line, arguments separated by spaces:
+//    p          pause stressing
+//    r          resume stressing
+//    s A B      statistics on segments A to B now
+//    g A B      segments A to B for scheduled checkpoints
+//    m MASK     measurements to run, CMD_MEASURE_x bits (hex)
+//    i N        PE cycles between scheduled checkpoints
+//    q          query progress
+//    d          dump the results log
+// Every command is answered with a line starting with '#'.
+// Flash erase and programming run with interrupts disabled and bytes
+// arriving meanwhile are lost, the host must wait for the answer and
+// send the command again if none arrives within a few seconds.
+// cmd_poll only records requests in cmd_state_s, the experiment loop
+// acts on them between stress bursts and between segments.
+//-------------------------------------------------------------------//
+
+#define CMD_MEASURE_BIT_VALUES    BIT0 // fs_check_bit_values
+#define CMD_MEASURE_PARTIAL_WRITE BIT1 // fs_get_partial_write_stats
+#define CMD_MEASURE_PARTIAL_ERASE BIT2 // fs_get_partial_erase_stats
+#define CMD_MEASURE_RAW_DUMP      BIT3 // raw_dump_start
+#define CMD_MEASURE_PROGRAM_THRESHOLD BIT4 // fs_get_program_threshold_stats
+#define CMD_MEASURE_ERASE_THRESHOLD   BIT5 // fs_get_erase_threshold_stats
+#define CMD_MEASURE_ECC               BIT6 // ecc_evaluate, runs the bit check too
+#define CMD_MEASURE_ALL           (BIT0 + BIT1 + BIT2 + BIT3 + BIT4 + BIT5 + BIT6)
+
+typedef struct cmd_state_struct {
+  uint32_t cycles;           // PE cycles done, kept up to date by the experiment
+  uint32_t total_cycles;
+  uint32_t increment_cycles; // PE cycles between scheduled checkpoints
+  uint16_t measure;          // CMD_MEASURE_x bits
+  uint16_t first_segment;    // range of scheduled checkpoints
+  uint16_t last_segment;
+  uint16_t request_first;    // range of a requested statistics pass
+  uint16_t request_last;
+  uint8_t paused;
+  uint8_t stats_requested;
+  uint8_t dump_requested;
+} cmd_state_s;
+
+void cmd_poll(cmd_state_s* state);
+/*
+  Function to handle a received command line, if there is one
+  Returns immediately otherwise
+*/
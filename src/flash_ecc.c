@@ -0,0 +1,123 @@
+#include "flash_ecc.h"
+#include <stdint.h>
+#include "flash_operations.h"
+
+#define ECC_MAX_BYTES 5 // bytes spanned by the longest codeword
+
+typedef struct ecc_code_struct {
+  uint8_t n_bits;    // codeword length
+  uint8_t data_bits;
+  uint8_t n_bytes;   // bytes a codeword spans
+  uint8_t last_mask; // valid bits of the last byte
+} ecc_code_s;
+
+static const ecc_code_s ecc_codes[ECC_N_CODES] = {
+  {22, 16, 3, 0x3F},
+  {39, 32, 5, 0x7F},
+};
+
+// syndrome of every value of every codeword byte, built by the compiler
+// bit 0 is the overall parity and the upper bits the Hamming syndrome
+// column of bit b of byte k in an n bit codeword, plus parity
+#define ECC_COL(n, k, b) ((8 * (k) + (b)) < (n) ? (((8 * (k) + (b)) << 1) | 1) : 0)
+#define ECC_BIT(n, k, v, b) (((v) >> (b)) & 1 ? ECC_COL(n, k, b) : 0)
+#define ECC_SYN(n, k, v) (ECC_BIT(n, k, v, 0) ^ ECC_BIT(n, k, v, 1) ^ \
+    ECC_BIT(n, k, v, 2) ^ ECC_BIT(n, k, v, 3) ^ ECC_BIT(n, k, v, 4) ^ \
+    ECC_BIT(n, k, v, 5) ^ ECC_BIT(n, k, v, 6) ^ ECC_BIT(n, k, v, 7))
+#define ECC_ROW4(n, k, v) ECC_SYN(n, k, v), ECC_SYN(n, k, (v) + 1), \
+    ECC_SYN(n, k, (v) + 2), ECC_SYN(n, k, (v) + 3)
+#define ECC_ROW16(n, k, v) ECC_ROW4(n, k, v), ECC_ROW4(n, k, (v) + 4), \
+    ECC_ROW4(n, k, (v) + 8), ECC_ROW4(n, k, (v) + 12)
+#define ECC_ROW64(n, k, v) ECC_ROW16(n, k, v), ECC_ROW16(n, k, (v) + 16), \
+    ECC_ROW16(n, k, (v) + 32), ECC_ROW16(n, k, (v) + 48)
+#define ECC_TABLE(n, k) {ECC_ROW64(n, k, 0), ECC_ROW64(n, k, 64), \
+    ECC_ROW64(n, k, 128), ECC_ROW64(n, k, 192)}
+
+static const uint8_t ecc_syndrome_22[3][256] = {
+  ECC_TABLE(22, 0), ECC_TABLE(22, 1), ECC_TABLE(22, 2)
+};
+static const uint8_t ecc_syndrome_39[5][256] = {
+  ECC_TABLE(39, 0), ECC_TABLE(39, 1), ECC_TABLE(39, 2), ECC_TABLE(39, 3), ECC_TABLE(39, 4)
+};
+
+static const uint8_t (* const ecc_tables[ECC_N_CODES])[256] = {
+  ecc_syndrome_22,
+  ecc_syndrome_39,
+};
+
+
+static uint8_t ecc_error_byte(const uint16_t* voted, uint16_t expected_val, uint16_t bit)
+// 8 bits of the error stream starting at bit, zero past the segment
+{
+  uint16_t w = bit >> 4;
+  uint32_t pair = voted[w] ^ expected_val;
+
+  if(w + 1 < F_SEGMENT_N_BYTES / 2)
+    pair |= (uint32_t)(voted[w + 1] ^ expected_val) << 16;
+
+  return (uint8_t)(pair >> (bit & 15));
+}
+
+void ecc_evaluate(const uint16_t* voted, uint16_t expected_val, uint8_t code,
+                  ecc_result_s* result)
+{
+  const ecc_code_s* c = &ecc_codes[code];
+  const uint8_t (*table)[256] = ecc_tables[code];
+  uint8_t bytes[ECC_MAX_BYTES];
+  uint8_t syndrome;
+  uint8_t position;
+  uint8_t any;
+  uint8_t single;
+
+  result->clean = 0;
+  result->corrected = 0;
+  result->detected = 0;
+  result->miscorrected = 0;
+
+  for(uint16_t bit = 0; bit + c->n_bits <= F_SEGMENT_N_BYTES * 8; bit += c->n_bits){
+    syndrome = 0;
+    any = 0;
+    for(uint8_t i = 0; i < c->n_bytes; i++){
+      bytes[i] = ecc_error_byte(voted, expected_val, bit + i * 8);
+      if(i == c->n_bytes - 1)
+        bytes[i] &= c->last_mask;
+      syndrome ^= table[i][bytes[i]];
+      any |= bytes[i];
+    }
+
+    if(!syndrome){
+      if(any)
+        result->miscorrected++; // 4 or more errors looking like none
+      else
+        result->clean++;
+      continue;
+    }
+
+    position = syndrome >> 1;
+    if(!(syndrome & 1) || position >= c->n_bits){
+      result->detected++; // even number of errors, or no such column
+      continue;
+    }
+
+    // the decoder flips position, right only if it was the one error
+    single = 1;
+    for(uint8_t i = 0; i < c->n_bytes; i++)
+      if(bytes[i] != ((position >> 3) == i ? (uint8_t)(1 << (position & 7)) : 0))
+        single = 0;
+
+    if(single)
+      result->corrected++;
+    else
+      result->miscorrected++;
+  }
+}
+
+uint8_t ecc_codeword_bits(uint8_t code)
+{
+  return ecc_codes[code].n_bits;
+}
+
+uint8_t ecc_data_bits(uint8_t code)
+{
+  return ecc_codes[code].data_bits;
+}
@@ -0,0 +1,39 @@
+//-------------------------------------------------------------------//
+// flash_ecc.h
+//-------------------------------------------------------------------//
+// Evaluation of SECDED codes over measured segment images, to tell
+// whether worn flash would still be usable behind error correction.
+// NOTES:
+// The segment is treated as a packed bitstream of codewords, the
+//    error of each cell is its voted value XOR the expected value.
+//    Data and check bits are both stored in measured cells, so errors
+//    in check bits count like any other. Bits left over at the end of
+//    the segment are not evaluated.
+// Codes are extended Hamming codes: bit 0 of a codeword is the overall
+//    parity, bit i > 0 has syndrome column i.
+// Syndromes are computed a byte at a time from const tables in flash,
+//    generated by the compiler from the code definitions.
+//-------------------------------------------------------------------//
+#pragma once
+#include <stdint.h>
+
+#define ECC_CODE_22_16 0 // Hamming(22,16), 186 codewords per segment
+#define ECC_CODE_39_32 1 // Hamming(39,32), 105 codewords per segment
+#define ECC_N_CODES    2
+
+typedef struct ecc_result_struct {
+  uint16_t clean;        // codewords without errors
+  uint16_t corrected;    // single errors, corrected
+  uint16_t detected;     // double errors, detected but not correctable
+  uint16_t miscorrected; // errors decoded to a wrong word or not detected
+} ecc_result_s;
+
+void ecc_evaluate(const uint16_t* voted, uint16_t expected_val, uint8_t code,
+                  ecc_result_s* result);
+/*
+  Function to decode every codeword of a segment image
+  voted is the segment as read, see fs_check_bit_values_voted
+*/
+
+uint8_t ecc_codeword_bits(uint8_t code);
+uint8_t ecc_data_bits(uint8_t code);
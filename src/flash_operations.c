@@ -3,13 +3,19 @@
 #include <stdint.h>
 #include "event_timer.h"
 #include "SRAM_subroutine_copy.h"
+#include "flash_trace.h"
 
 #define BANK_SEGMENT_SIZE 512
 #define INFO_SEGMENT_SIZE 128
 
 void f_segment_erase(uint16_t* segPtr)
 {
+  uint16_t start;
+  uint16_t gie = __get_interrupt_state();
+
+  __disable_interrupt(); // an interrupt must not fetch from flash while BUSY
   while(FCTL3 & BUSY);
+  start = FT_START;
 
   FCTL3 = FWPW; //clear lock
   FCTL1 = FWPW + ERASE; // enable segment erase
@@ -17,9 +23,11 @@ void f_segment_erase(uint16_t* segPtr)
 
   while(FCTL3 & BUSY); // loop while busy
   // not really necessary when executing from flash
+  FT_RECORD(FT_OP_SEGMENT_ERASE, segPtr, start);
 
   FCTL1 = FWPW; // clear ERASE
   FCTL3 = FWPW + LOCK; // lock
+  __set_interrupt_state(gie);
 }
 
 
@@ -42,7 +50,12 @@ void f_segment_erase_timed(uint16_t* segPtr)
 
 void f_bank_erase(uint16_t* bankPtr)
 {
+  uint16_t start;
+  uint16_t gie = __get_interrupt_state();
+
+  __disable_interrupt(); // an interrupt must not fetch from flash while BUSY
   while(FCTL3 & BUSY);
+  start = FT_START;
 
   FCTL3 = FWPW; //clear lock
   FCTL1 = FWPW + MERAS; // enable bank erase
@@ -50,9 +63,11 @@ void f_bank_erase(uint16_t* bankPtr)
 
   while(FCTL3 & BUSY); // loop while busy
   // not really necessary when executing from flash
+  FT_RECORD(FT_OP_BANK_ERASE, bankPtr, start);
 
   FCTL1 = FWPW; // clear MERASE
   FCTL3 = FWPW + LOCK; // lock
+  __set_interrupt_state(gie);
 }
 
 void f_bank_erase_timed(uint16_t* bankPtr)
@@ -74,16 +89,23 @@ void f_bank_erase_timed(uint16_t* bankPtr)
 
 void f_word_write(uint16_t value, uint16_t* targetPtr)
 {
+  uint16_t start;
+  uint16_t gie = __get_interrupt_state();
+
+  __disable_interrupt(); // an interrupt must not fetch from flash while BUSY
   while(FCTL3 & BUSY);
+  start = FT_START;
 
   FCTL3 = FWPW; //clear lock
   FCTL1 = FWPW + WRT; // enable word write
   *targetPtr = value; // write value
 
   while(FCTL3 & BUSY);
+  FT_RECORD(FT_OP_WORD_WRITE, targetPtr, start);
 
   FCTL1 = FWPW; // clear WRT
   FCTL3 = FWPW + LOCK; // lock
+  __set_interrupt_state(gie);
 }
 
 void f_word_write_timed(uint16_t value, uint16_t* targetPtr)
@@ -118,7 +140,7 @@ void f_safe_word_write(uint16_t value, uint16_t* targetPtr, f_segment_t seg, uin
   for(int i = 0; i < segSize; i++) // copy items over to RAM
     savedArray[i] = ((uint16_t*)seg)[i];
 
-  savedArray[(targetPtr - seg) >> 1] = value;
+  savedArray[targetPtr - (uint16_t*)seg] = value;
   // place new value
 
   f_segment_erase((uint16_t*)seg);
@@ -135,7 +157,13 @@ void f_block_set(uint16_t value, uint16_t* blockPtr)
 // Only a 128 byte row can be written at once
 // must be executed from RAM
 {
+  uint16_t* startPtr = blockPtr;
+  uint16_t start;
+  uint16_t gie = __get_interrupt_state();
+
+  __disable_interrupt(); // the vectors and handlers are in flash
   while(FCTL3 & BUSY);
+  start = FT_START;
 
   FCTL3 = FWPW; // clear lock
 
@@ -151,9 +179,11 @@ void f_block_set(uint16_t value, uint16_t* blockPtr)
     FCTL1 = FWPW + WRT; // clear BLKWRT
     while(FCTL3 & BUSY);
   }
+  FT_RECORD(FT_OP_BLOCK_SET, startPtr, start);
 
   FCTL1 = FWPW; // clear BLKWRT and WRT
   FCTL3 = FWPW + LOCK; // lock
+  __set_interrupt_state(gie);
 }
 void end_f_block_set(void) {}
 
@@ -369,7 +399,7 @@ void f_word_partial_write_12(uint16_t partialValue, uint16_t* targetPtr)
 void end_f_word_partial_write_12(void) {}
 
 
-void f_stress_segment(f_segment_t seg, uint16_t val, uint32_t iterations)
+uint8_t f_stress_segment(f_segment_t seg, uint16_t val, uint32_t iterations)
 // Since erasing flash forces all bits high, a value of 0x0000 will result in
 //    the highest possible stresssing of all bits.
 // LEAVES A SEGMENT WITH THE VALUE OF VAL IN EVERY WORD
@@ -378,7 +408,7 @@ void f_stress_segment(f_segment_t seg, uint16_t val, uint32_t iterations)
 
   SRAM_f_block_set = malloc_subroutine(f_block_set, end_f_block_set);
   if(!(void*)SRAM_f_block_set)
-    return; // null pointer means the memory cannot be allocated
+    return 0; // null pointer means the memory cannot be allocated
 
   for (uint32_t i = iterations; i != 0; i--){
     f_segment_erase((uint16_t*)seg);
@@ -387,25 +417,116 @@ void f_stress_segment(f_segment_t seg, uint16_t val, uint32_t iterations)
   }
 
   free((void*)SRAM_f_block_set); // deallocate memory
+  return 1;
 }
 
-void f_stress_bank(f_bank_t bank, uint16_t val, uint32_t iterations)
+uint8_t f_stress_bank(f_bank_t bank, uint16_t val, uint32_t iterations)
 {
   f_segment_t target;
   void (*SRAM_f_block_set)(uint16_t, uint16_t*); // declare function pointer
 
   SRAM_f_block_set = malloc_subroutine(f_block_set, end_f_block_set);
   if(!(void*)SRAM_f_block_set)
-    return; // null pointer means the memory cannot be allocated
-
-  target = (f_segment_t)bank;
+    return 0; // null pointer means the memory cannot be allocated
 
   for (uint32_t i = iterations; i != 0; i--){
     f_bank_erase((uint16_t*)bank);
 
+    target = (f_segment_t)bank;
     for(uint8_t s = F_BANK_N_SEGMENTS; s != 0; s--) // set all segments in the bank
       SRAM_f_block_set(val, (uint16_t*)(target++));
   }
 
   free((void*)SRAM_f_block_set); // deallocate memory
+  return 1;
+}
+
+
+void f_fail_table_init(f_fail_table_s* table, uint32_t cycle)
+{
+  table->cycle = cycle;
+  for(uint8_t s = 0; s < F_BANK_N_SEGMENTS; s++)
+    table->first_fail[s] = F_FAIL_NONE;
+}
+
+uint16_t f_segment_verify(f_segment_t seg, uint16_t val)
+// unrolled, a verify costs about 4 MCLK cycles per word
+{
+  const uint16_t* read_head = (const uint16_t*)seg;
+  uint16_t differences = 0;
+
+  for(uint8_t i = F_SEGMENT_N_BYTES / 16; i != 0; i--){
+    differences |= read_head[0] ^ val;
+    differences |= read_head[1] ^ val;
+    differences |= read_head[2] ^ val;
+    differences |= read_head[3] ^ val;
+    differences |= read_head[4] ^ val;
+    differences |= read_head[5] ^ val;
+    differences |= read_head[6] ^ val;
+    differences |= read_head[7] ^ val;
+    read_head += 8;
+  }
+
+  return differences;
+}
+
+uint8_t f_stress_segment_verified(f_segment_t seg, uint16_t val, uint32_t iterations,
+                                  f_fail_table_s* table, uint8_t index, uint16_t interval)
+// LEAVES A SEGMENT WITH THE VALUE OF VAL IN EVERY WORD
+{
+  void (*SRAM_f_block_set)(uint16_t, uint16_t*); // declare function pointer
+  uint8_t verify;
+
+  SRAM_f_block_set = malloc_subroutine(f_block_set, end_f_block_set);
+  if(!(void*)SRAM_f_block_set)
+    return 0; // null pointer means the memory cannot be allocated
+
+  for (uint32_t i = iterations; i != 0; i--){
+    table->cycle++;
+    verify = interval && table->first_fail[index] == F_FAIL_NONE && table->cycle % interval == 0;
+
+    f_segment_erase((uint16_t*)seg);
+    if(verify && f_segment_verify(seg, 0xFFFF))
+      table->first_fail[index] = table->cycle;
+
+    SRAM_f_block_set(val, (uint16_t*)seg);
+    if(verify && f_segment_verify(seg, val))
+      table->first_fail[index] = table->cycle;
+  }
+
+  free((void*)SRAM_f_block_set); // deallocate memory
+  return 1;
+}
+
+uint8_t f_stress_bank_verified(f_bank_t bank, uint16_t val, uint32_t iterations,
+                               f_fail_table_s* table, uint16_t interval)
+{
+  f_segment_t target;
+  void (*SRAM_f_block_set)(uint16_t, uint16_t*); // declare function pointer
+  uint8_t verify;
+
+  SRAM_f_block_set = malloc_subroutine(f_block_set, end_f_block_set);
+  if(!(void*)SRAM_f_block_set)
+    return 0; // null pointer means the memory cannot be allocated
+
+  for (uint32_t i = iterations; i != 0; i--){
+    table->cycle++;
+    verify = interval && table->cycle % interval == 0;
+
+    f_bank_erase((uint16_t*)bank);
+
+    target = (f_segment_t)bank;
+    for(uint8_t s = 0; s < F_BANK_N_SEGMENTS; s++, target++){
+      if(verify && table->first_fail[s] == F_FAIL_NONE && f_segment_verify(target, 0xFFFF))
+        table->first_fail[s] = table->cycle;
+
+      SRAM_f_block_set(val, (uint16_t*)target);
+
+      if(verify && table->first_fail[s] == F_FAIL_NONE && f_segment_verify(target, val))
+        table->first_fail[s] = table->cycle;
+    }
+  }
+
+  free((void*)SRAM_f_block_set); // deallocate memory
+  return 1;
 }
@@ -10,6 +10,8 @@
 // CODE_SECTION pragma is used to ensure that the functions are placed
 //    sequentially
 // SECTIONS MUST BE DEFINED IN LINKER COMMAND FILE
+// The untimed erase, write and block set disable interrupts until the
+//    flash is locked again and then restore the previous state
 //-------------------------------------------------------------------//
 #pragma once
 #include <msp430.h>
@@ -39,6 +41,8 @@
 #define F_BANK_N_SEGMENTS 64
 #define F_SEGMENT_N_BYTES 512
 
+#define F_FAIL_NONE 0xFFFFFFFF // first_fail of a segment that never failed
+
 
 // Both of these structures are not meant to be used as actual structures
 // instead they will be used as pointers with custom increment amounts
@@ -51,6 +55,11 @@ typedef struct f_bank_struct {
   f_segment_t segCount[64];
 } *f_bank_t;
 
+typedef struct f_fail_table_struct {
+  uint32_t cycle; // PE cycles done, advanced by the verified stress functions
+  uint32_t first_fail[F_BANK_N_SEGMENTS]; // cycle of the first failed verify
+} f_fail_table_s;
+
 void f_segment_erase(uint16_t* segPtr);
 void f_segment_erase_timed(uint16_t* segPtr);
 
@@ -94,7 +103,34 @@ void f_word_partial_write_12(uint16_t partialValue, uint16_t* targetPtr);
 void end_f_word_partial_write_12(void);
 
 
-void f_stress_segment(f_segment_t seg, uint16_t val, uint32_t iterations);
+uint8_t f_stress_segment(f_segment_t seg, uint16_t val, uint32_t iterations);
+
+uint8_t f_stress_bank(f_bank_t bank, uint16_t val, uint32_t iterations);
+/*
+  Functions to erase and set to val iterations times
+  Return 0 without stressing if f_block_set cannot be copied to RAM
+*/
+
+
+
+void f_fail_table_init(f_fail_table_s* table, uint32_t cycle);
+
+uint16_t f_segment_verify(f_segment_t seg, uint16_t val);
+/*
+  Function to check that every word of a segment reads val
+  Returns the OR of every word XOR val, 0 if the segment is correct
+*/
 
-void f_stress_bank(f_bank_t bank, uint16_t val, uint32_t iterations);
+uint8_t f_stress_segment_verified(f_segment_t seg, uint16_t val, uint32_t iterations,
+                                  f_fail_table_s* table, uint8_t index, uint16_t interval);
 
+uint8_t f_stress_bank_verified(f_bank_t bank, uint16_t val, uint32_t iterations,
+                               f_fail_table_s* table, uint16_t interval);
+/*
+  Same as f_stress_segment and f_stress_bank, every interval cycles each
+  segment that has not failed yet is verified after the erase and after
+  it is set to val. The cycle of its first failed verify is stored in
+  table->first_fail, interval 1 gives the exact cycle,
+  interval 0 never verifies
+  Return 0 like f_stress_segment, table->cycle is then unchanged
+*/
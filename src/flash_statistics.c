@@ -8,7 +8,26 @@
 
 #define STAT_READ_COUNT 11
 
+#ifndef FS_READ_WORD
+#define FS_READ_WORD(ptr) (*(ptr)) // host builds serve reads from memory
+#endif
+
+static inline uint16_t fs_popcount(uint16_t x)
+// number of set bits, counted in parallel
+{
+  x = x - ((x >> 1) & 0x5555);
+  x = (x & 0x3333) + ((x >> 2) & 0x3333);
+  x = (x + (x >> 4)) & 0x0F0F;
+  return (x + (x >> 8)) & 0x001F;
+}
+
 void fs_check_bit_values(f_segment_t seg, fs_stats_s* stats, uint16_t expected_val)
+{
+  fs_check_bit_values_voted(seg, stats, expected_val, 0);
+}
+
+void fs_check_bit_values_voted(f_segment_t seg, fs_stats_s* stats, uint16_t expected_val,
+                               uint16_t* voted)
 // majority based voting
 // position of bits not set correctly
 {
@@ -16,18 +35,19 @@ void fs_check_bit_values(f_segment_t seg, fs_stats_s* stats, uint16_t expected_v
   uint16_t differences;
   uint16_t* read_head = (uint16_t*)seg;
   uint8_t voted_bit;
+  uint16_t voted_word;
 
   stats->incorrect_bit_count = 0;
   stats->unstable_bit_count = 0;
   
-  while(read_head < (seg + 1)){
+  while(read_head < (uint16_t*)(seg + 1)){
     uint16_t bit_votes[16] = {0};
 
 
     // unstable bit detection
     for (uint8_t i = 0; i < STAT_READ_COUNT; i++){
 
-      word_bin = *read_head;
+      word_bin = FS_READ_WORD(read_head);
 
       for (uint8_t b = 0; b < 16; b++) {
           if (word_bin & (1 << b)) {
@@ -35,7 +55,7 @@ void fs_check_bit_values(f_segment_t seg, fs_stats_s* stats, uint16_t expected_v
           }
       }
 
-      differences = word_bin ^ *read_head;
+      differences = word_bin ^ FS_READ_WORD(read_head);
       for (uint8_t s = 16; s != 0; s--){
         if(differences & BIT0)
           stats->unstable_bit_count++;
@@ -44,12 +64,16 @@ void fs_check_bit_values(f_segment_t seg, fs_stats_s* stats, uint16_t expected_v
     }
 
     // Form voted word based on majority (6 or more)
+    voted_word = 0;
     for (uint8_t b = 0; b < 16; b++) {
       voted_bit =  (bit_votes[b] >= (STAT_READ_COUNT / 2 + 1));
+      voted_word |= (uint16_t)voted_bit << b;
 
-      if (voted_bit ^ (expected_val << b))
+      if (voted_bit ^ ((expected_val >> b) & 1))
         stats->incorrect_bit_count++;
     }
+    if (voted)
+      *(voted++) = voted_word;
 
     read_head++;
   }
@@ -133,7 +157,7 @@ void fs_get_partial_erase_stats(f_segment_t seg, fs_stats_s* stats)
   for (uint8_t test = sizeof(testDelayArray) / sizeof(testDelayArray[0]); \
        test != 0; test--){
     // a delay of 1024 is equivalent to 1ms
-    SRAM_p_erase(seg, testDelayArray[test]);
+    SRAM_p_erase((uint16_t*)seg, testDelayArray[test - 1]);
     if (*((uint16_t*)seg) != 0xFFFF){
       free(SRAM_p_erase);
       return;
@@ -142,3 +166,91 @@ void fs_get_partial_erase_stats(f_segment_t seg, fs_stats_s* stats)
   }
   free(SRAM_p_erase);
 }
+
+
+void fs_get_program_threshold_stats(f_segment_t seg, fs_threshold_s* hist, uint16_t val)
+{
+  void (*SRAM_p_write)(uint16_t, uint16_t*);
+  uint16_t* write_head = (uint16_t*)seg;
+  uint16_t pending; // bits still to be programmed
+  uint16_t remaining;
+
+  for(uint8_t i = 0; i <= FS_PT_MAX_PULSES; i++)
+    hist->pulses[i] = 0;
+
+  SRAM_p_write = malloc_subroutine(f_word_partial_write_0, end_f_word_partial_write_0);
+  if(!(void*)SRAM_p_write)
+    return; // null pointer means the memory cannot be allocated
+
+  f_segment_erase((uint16_t*)seg);
+
+  while(write_head < (uint16_t*)(seg + 1)){
+    pending = FS_READ_WORD(write_head) & ~val;
+
+    for(uint8_t p = 0; pending && p < FS_PT_MAX_PULSES; p++){
+      SRAM_p_write(val, write_head);
+      remaining = FS_READ_WORD(write_head) & pending;
+      hist->pulses[p] += fs_popcount(pending ^ remaining); // newly flipped bits
+      pending = remaining;
+    }
+    hist->pulses[FS_PT_MAX_PULSES] += fs_popcount(pending);
+
+    write_head++;
+  }
+
+  free(SRAM_p_write);
+}
+
+
+static uint16_t fs_count_ones(f_segment_t seg)
+// erased and programmed words are the common case and skip the popcount
+{
+  uint16_t* read_head = (uint16_t*)seg;
+  uint16_t ones = 0;
+  uint16_t word;
+
+  while(read_head < (uint16_t*)(seg + 1)){
+    word = FS_READ_WORD(read_head);
+    if(word == 0xFFFF)
+      ones += 16;
+    else if(word)
+      ones += fs_popcount(word);
+    read_head++;
+  }
+  return ones;
+}
+
+void fs_get_erase_threshold_stats(f_segment_t seg, fs_threshold_s* hist)
+{
+  void (*SRAM_p_erase)(uint16_t*, uint16_t);
+  uint16_t ones;
+  uint16_t previous_ones;
+
+  for(uint8_t i = 0; i <= FS_ET_MAX_PULSES; i++)
+    hist->pulses[i] = 0;
+
+  if(!f_stress_segment(seg, 0x0000, 1)) // erase and program every bit to 0
+    return;
+
+  SRAM_p_erase = malloc_subroutine(f_segment_partial_erase_x, \
+      end_f_segment_partial_erase_x);
+  if(!(void*)SRAM_p_erase)
+    return; // null pointer means the memory cannot be allocated
+
+  // bits that would not program are not counted
+  previous_ones = fs_count_ones(seg);
+
+  for(uint8_t p = 0; p < FS_ET_MAX_PULSES; p++){
+    SRAM_p_erase((uint16_t*)seg, FS_ET_PULSE_TICKS);
+    ones = fs_count_ones(seg);
+    if(ones <= previous_ones)
+      continue; // nothing erased, or bits on the edge read back as 0
+    hist->pulses[p] = ones - previous_ones; // newly erased bits
+    previous_ones = ones;
+    if(ones == F_SEGMENT_N_BYTES * 8)
+      break;
+  }
+  hist->pulses[FS_ET_MAX_PULSES] = F_SEGMENT_N_BYTES * 8 - previous_ones;
+
+  free(SRAM_p_erase);
+}
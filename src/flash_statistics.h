@@ -11,6 +11,10 @@
 #define FS_PARTIAL_WRITE_FAIL 0xFFFF
 #define FS_PARTIAL_ERASE_FAIL 0xFFFF
 
+#define FS_PT_MAX_PULSES 16 // program pulses applied before a bit is given up on
+#define FS_ET_MAX_PULSES FS_PT_MAX_PULSES // erase pulses, shares fs_threshold_s
+#define FS_ET_PULSE_TICKS 1024 // length of one erase pulse, 1024 is ~1ms
+
 typedef struct fs_stats_struct {
   unsigned int incorrect_bit_count; // bits that are not the value expected
   unsigned int unstable_bit_count; // bits that change atleast once in 11 reads
@@ -20,6 +24,12 @@ typedef struct fs_stats_struct {
   unsigned int partial_erase_latency;
 } fs_stats_s;
 
+typedef struct fs_threshold_struct {
+  // bits that needed n+1 pulses to flip, the last bin counts bits that
+  // did not flip after the maximum number of pulses
+  uint16_t pulses[FS_PT_MAX_PULSES + 1];
+} fs_threshold_s;
+
 void fs_check_bit_values(f_segment_t seg, fs_stats_s* stats, uint16_t expected_val);
 /*
   Function to get the number of incorrect bits and unstable bits in a segment
@@ -28,6 +38,13 @@ void fs_check_bit_values(f_segment_t seg, fs_stats_s* stats, uint16_t expected_v
   unstable bit - Bit that reads differently atleast once out of STAT_READ_COUNT times
 */
 
+void fs_check_bit_values_voted(f_segment_t seg, fs_stats_s* stats, uint16_t expected_val,
+                               uint16_t* voted);
+/*
+  Same as fs_check_bit_values, also stores the voted value of every word
+  of the segment in voted (F_SEGMENT_N_BYTES / 2 words) unless it is 0
+*/
+
 void fs_get_partial_write_stats(uint16_t* target, fs_stats_s* stats, uint16_t val);
 /*
   Function to get the fastest partial word write possible for a flash segment
@@ -37,5 +54,21 @@ void fs_get_partial_write_stats(uint16_t* target, fs_stats_s* stats, uint16_t va
 void fs_get_partial_erase_stats(f_segment_t seg, fs_stats_s* stats);
 /*
   Function to get the fastest partial segment erase possible for a flash segment
-  Tests 12, 10, 8, 6, 4, 0 ms delayed partial erases
+  Tests 12, 10, 8, 6, 4, 2 tick (~1 us) delayed partial erases
+*/
+
+void fs_get_program_threshold_stats(f_segment_t seg, fs_threshold_s* hist, uint16_t val);
+/*
+  Function to get the distribution of program thresholds of a flash segment
+  Erases the segment, then applies 0 NOP delayed partial word writes of val
+  to each word until every bit that should be programmed has flipped
+  The number of pulses each bit needed is counted in hist
+*/
+
+void fs_get_erase_threshold_stats(f_segment_t seg, fs_threshold_s* hist);
+/*
+  Function to get the distribution of erase thresholds of a flash segment
+  Programs the segment to 0x0000, then applies FS_ET_PULSE_TICKS partial
+  segment erases until every bit has flipped to 1
+  The number of pulses each bit needed is counted in hist
 */
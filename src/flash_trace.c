@@ -0,0 +1,79 @@
+#include "flash_trace.h"
+#include <msp430.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "Serial.h"
+
+// from the datasheet timings at ~131 KHz, loose enough for loop overhead
+static const ft_limit_s ft_limits[FT_N_OPS] = {
+  {0, 0xFFFF},  // FT_OP_BOOT, flags only
+  {2900, 4400}, // FT_OP_SEGMENT_ERASE, 23 - 32 ms
+  {2900, 4400}, // FT_OP_BANK_ERASE, 23 - 32 ms
+  {6, 16},      // FT_OP_WORD_WRITE, 64 - 85 us
+  {400, 1200},  // FT_OP_BLOCK_SET, 4 rows of 128 bytes
+};
+
+static ft_event_s ft_events[FT_N_EVENTS];
+static uint8_t ft_head; // next event to write
+static uint8_t ft_count;
+static uint16_t ft_lost; // overwritten before they were drained
+static char ft_line[40];
+
+
+void ft_init(void)
+{
+  TB0CTL = TBSSEL_2 + ID__8 + MC_2 + TBCLR; // SMCLK / 8, continuous mode
+
+  if(FCTL3 & KEYV){
+    ft_record(FT_OP_BOOT, 0, FT_FLAG_KEYV, 0);
+    FCTL3 = FWPW + LOCK; // clear KEYV
+  }
+}
+
+void ft_check(uint8_t op, uint32_t address, uint16_t start)
+// the call costs well under one Timer B0 tick
+{
+  uint16_t duration = TB0R - start;
+  uint8_t flags = (FCTL3 & (KEYV + ACCVIFG)) | ((FCTL4 & VPE) ? FT_FLAG_VPE : 0);
+
+  if(flags || duration < ft_limits[op].min || duration > ft_limits[op].max)
+    ft_record(op, address, flags, duration);
+}
+
+void ft_record(uint8_t op, uint32_t address, uint8_t flags, uint16_t duration)
+{
+  ft_event_s* event = &ft_events[ft_head];
+
+  event->op = op;
+  event->flags = flags;
+  event->duration = duration;
+  event->address = address;
+
+  ft_head = (ft_head + 1) & (FT_N_EVENTS - 1);
+  if(ft_count < FT_N_EVENTS)
+    ft_count++;
+  else
+    ft_lost++;
+
+  if(flags & FT_FLAG_VPE)
+    FCTL4 = FWPW + (FCTL4 & 0x00FF & ~VPE); // clear VPE, keep the other bits
+}
+
+void ft_drain(void)
+{
+  ft_event_s* event;
+
+  while(ft_count){
+    event = &ft_events[(ft_head - ft_count) & (FT_N_EVENTS - 1)];
+    sprintf(ft_line, "#FT %X %05lX %02X %04X\n", event->op, event->address,
+            event->flags, event->duration);
+    Serial0_write(ft_line);
+    ft_count--;
+  }
+
+  if(ft_lost){
+    sprintf(ft_line, "#FT LOST %u\n", ft_lost);
+    Serial0_write(ft_line);
+    ft_lost = 0;
+  }
+}
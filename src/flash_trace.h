@@ -0,0 +1,81 @@
+//-------------------------------------------------------------------//
+// flash_trace.h
+//-------------------------------------------------------------------//
+// Ring buffer of flash controller events, so that access violations
+// and operations that take an unusual time are reported instead of
+// showing up as unexplained statistics.
+// NOTES:
+// FT_START and FT_RECORD are placed around an operation, FT_RECORD
+//    must come after BUSY clears and before FCTL3 is locked, the lock
+//    write clears ACCVIFG.
+// Only anomalies are stored: a flag set or a duration outside the
+//    limits in ft_limits.
+// FT_RECORD is only a call to ft_check, which stays in flash, so that
+//    routines executed from RAM are not grown by the check. It may be
+//    used there once the controller is idle.
+// Routines that time themselves with the event timer and the emergency
+//    exit routines are not traced, the check would change their timing.
+// The F5529 controller has no FAIL flag, VPE from FCTL4 is recorded
+//    instead. KEYV causes a PUC and is recorded by ft_init after reset.
+// RESOURCE USAGE: Timer B0, free running at SMCLK / 8 (~7.6 us ticks)
+//-------------------------------------------------------------------//
+#pragma once
+#include <msp430.h>
+#include <stdint.h>
+
+#define FT_N_EVENTS 16 // must be a power of 2
+
+// operations
+#define FT_OP_BOOT          0 // flags found after reset
+#define FT_OP_SEGMENT_ERASE 1
+#define FT_OP_BANK_ERASE    2
+#define FT_OP_WORD_WRITE    3
+#define FT_OP_BLOCK_SET     4
+#define FT_N_OPS            5
+
+// flags, KEYV and ACCVIFG keep their FCTL3 positions
+#define FT_FLAG_VPE     0x01 // FCTL4 VPE, supply changed during programming
+#define FT_FLAG_KEYV    KEYV
+#define FT_FLAG_ACCVIFG ACCVIFG
+
+typedef struct ft_event_struct {
+  uint8_t op;
+  uint8_t flags;
+  uint16_t duration; // Timer B0 ticks
+  uint32_t address;
+} ft_event_s;
+
+typedef struct ft_limit_struct {
+  uint16_t min; // Timer B0 ticks
+  uint16_t max;
+} ft_limit_s;
+
+#ifndef FT_RECORD // host builds do not trace
+#define FT_START TB0R
+#define FT_RECORD(op, address, start) ft_check(op, (uint32_t)(uintptr_t)(address), start)
+#endif
+
+void ft_init(void);
+/*
+  Function to start Timer B0 and record flags left by a reset
+  Must be called before any traced flash operation
+*/
+
+void ft_check(uint8_t op, uint32_t address, uint16_t start);
+/*
+  Function to read the flags and the time since start (FT_START) and
+  record the operation if they are anomalous
+  Must be called before FCTL3 is locked
+*/
+
+void ft_record(uint8_t op, uint32_t address, uint8_t flags, uint16_t duration);
+/*
+  Stores an event, overwriting the oldest one when the buffer is full
+  Clears VPE, which is only cleared by software
+*/
+
+void ft_drain(void);
+/*
+  Function to send and remove every stored event over Serial0
+  One line per event: "#FT op address flags duration", all hex
+*/
@@ -0,0 +1,90 @@
+#include "raw_dump.h"
+#include <msp430.h>
+#include <stdint.h>
+#include "flash_operations.h"
+
+static uint8_t raw_header[RAW_HEADER_N_BYTES] = {'R', 'A', 'W'};
+static f_segment_t raw_segment;       // segment being sent
+static uint8_t raw_segments_left = 0; // 0 when no dump is running
+static uint8_t raw_header_sent;
+
+
+static void raw_send(uint8_t* src, uint16_t size)
+// the trigger is edge sensitive, so the first byte is written by hand and
+// every TXIFG rising edge after it moves one more byte
+{
+  __data16_write_addr((unsigned short)&DMA0SA, (unsigned long)(src + 1));
+  DMA0SZ = size - 1;
+
+  while(!(UCA1IFG & UCTXIFG)); // last byte of the previous transfer is out
+  DMA0CTL |= DMAEN; // TXIFG is already high, no edge yet
+  UCA1TXBUF = *src;
+}
+
+static void raw_next(void)
+// alternates between the header and the body of each segment
+{
+  if(!raw_header_sent){
+    raw_header[3] = F_BANK_N_SEGMENTS - raw_segments_left;
+    raw_header_sent = 1;
+    raw_send(raw_header, RAW_HEADER_N_BYTES);
+    return;
+  }
+
+  raw_header_sent = 0;
+  raw_segments_left--;
+  raw_send((uint8_t*)raw_segment++, F_SEGMENT_N_BYTES);
+}
+
+
+void raw_dump_start(f_bank_t bank, uint32_t cycles)
+{
+  raw_dump_wait(); // only one dump at a time
+
+  for(uint8_t i = 0; i < 4; i++)
+    raw_header[4 + i] = (uint8_t)(cycles >> (8 * i));
+
+  raw_segment = (f_segment_t)bank;
+  raw_segments_left = F_BANK_N_SEGMENTS;
+  raw_header_sent = 0;
+
+  DMACTL0 = DMA0TSEL_21; // UCA1TXIFG trigger
+  __data16_write_addr((unsigned short)&DMA0DA, (unsigned long)&UCA1TXBUF);
+  DMA0CTL = DMADT_0 + DMASRCINCR_3 + DMASBDB + DMAIE;
+  // single transfer, increment source, byte to byte, edge trigger
+  // (level triggers are only supported for DMAE0)
+
+  __enable_interrupt();
+  raw_next();
+}
+
+uint8_t raw_dump_busy(void)
+{
+  return raw_segments_left || (DMA0CTL & DMAEN);
+}
+
+void raw_dump_wait(void)
+{
+  __disable_interrupt(); // LPM0 must be entered before the last interrupt
+  while(raw_dump_busy()){
+    __bis_SR_register(LPM0_bits + GIE);
+    __disable_interrupt();
+  }
+  __enable_interrupt();
+}
+
+
+#pragma vector=DMA_VECTOR
+__interrupt void raw_dump_isr(void)
+{
+  switch(__even_in_range(DMAIV, 16)){
+    case DMAIV_DMA0IFG:
+      if(raw_segments_left || raw_header_sent)
+        raw_next();
+      else
+        __bic_SR_register_on_exit(LPM0_bits); // last segment sent
+      break;
+    default:
+      break;
+  }
+}
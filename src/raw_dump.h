@@ -0,0 +1,33 @@
+#pragma once
+#include <msp430.h>
+#include <stdint.h>
+#include "flash_operations.h"
+
+//-------------------------------------------------------------------//
+// raw_dump.h
+//-------------------------------------------------------------------//
+// Streams the raw contents of every segment of a bank out of USCI_A1
+// with DMA channel 0, so the CPU is free while the image is sent.
+// Each segment is sent as one binary frame:
+//    'R' 'A' 'W' <segment #> <cycle count, 4 bytes little endian>
+//    followed by the F_SEGMENT_N_BYTES bytes of the segment
+// NOTES:
+// Serial0_write must not be used while a dump is running
+// The bank must not be erased or written while a dump is running,
+//    call raw_dump_wait before touching it
+// RESOURCE USAGE: DMA channel 0, DMA interrupt, sets GIE
+//-------------------------------------------------------------------//
+
+#define RAW_HEADER_N_BYTES 8
+
+void raw_dump_start(f_bank_t bank, uint32_t cycles);
+/*
+  Function to start sending every segment of bank, returns immediately
+*/
+
+uint8_t raw_dump_busy(void);
+
+void raw_dump_wait(void);
+/*
+  Function to sleep in LPM0 until the running dump is finished
+*/
@@ -0,0 +1,121 @@
+#include "read_disturb.h"
+#include <msp430.h>
+#include <stdint.h>
+#include "flash_operations.h"
+#include "event_timer.h"
+#include "SRAM_subroutine_copy.h"
+
+// iterations per timed chunk, both well under the 2 s slow timer range
+#define RD_WORD_CHUNK     4096  // 65536 reads
+#define RD_SEGMENT_CHUNK  64    // 16384 reads
+
+#define ACLK_HZ 32768
+
+
+void rd_hammer_word(uint16_t* target, uint16_t iterations)
+// THIS FUNCTION MUST BE EXECUTED FROM RAM
+{
+  volatile uint16_t* read_head = target;
+
+  for(; iterations != 0; iterations--){
+    *read_head; // 16x reads
+    *read_head;
+    *read_head;
+    *read_head;
+    *read_head;
+    *read_head;
+    *read_head;
+    *read_head;
+    *read_head;
+    *read_head;
+    *read_head;
+    *read_head;
+    *read_head;
+    *read_head;
+    *read_head;
+    *read_head;
+  }
+}
+void end_rd_hammer_word(void) {}
+
+
+void rd_hammer_segment(f_segment_t seg, uint16_t iterations)
+// THIS FUNCTION MUST BE EXECUTED FROM RAM
+{
+  volatile uint16_t* read_head;
+
+  for(; iterations != 0; iterations--){
+    read_head = (volatile uint16_t*)seg;
+
+    for(uint8_t i = F_SEGMENT_N_BYTES / 16; i != 0; i--){
+      read_head[0]; // 8x reads
+      read_head[1];
+      read_head[2];
+      read_head[3];
+      read_head[4];
+      read_head[5];
+      read_head[6];
+      read_head[7];
+      read_head += 8;
+    }
+  }
+}
+void end_rd_hammer_segment(void) {}
+
+
+void rd_disturb_word(uint16_t* target, uint32_t reads, rd_result_s* result)
+{
+  void (*SRAM_hammer)(uint16_t*, uint16_t);
+  uint32_t iterations = (reads + RD_WORD_READS_PER_ITERATION - 1) / RD_WORD_READS_PER_ITERATION;
+  uint16_t chunk;
+
+  SRAM_hammer = malloc_subroutine(rd_hammer_word, end_rd_hammer_word);
+  if(!(void*)SRAM_hammer)
+    return; // null pointer means the memory cannot be allocated
+
+  while(iterations){
+    chunk = iterations > RD_WORD_CHUNK ? RD_WORD_CHUNK : iterations;
+
+    SLOW_EVENT_TIMER_START;
+    SRAM_hammer(target, chunk);
+    result->ticks += TA0R;
+    TA0CTL &= ~MC_3; // halt timer
+
+    result->reads += (uint32_t)chunk * RD_WORD_READS_PER_ITERATION;
+    iterations -= chunk;
+  }
+
+  free((void*)SRAM_hammer);
+}
+
+void rd_disturb_segment(f_segment_t seg, uint32_t reads, rd_result_s* result)
+{
+  void (*SRAM_hammer)(f_segment_t, uint16_t);
+  uint32_t iterations = reads; // one sweep reads every word once
+  uint16_t chunk;
+
+  SRAM_hammer = malloc_subroutine(rd_hammer_segment, end_rd_hammer_segment);
+  if(!(void*)SRAM_hammer)
+    return; // null pointer means the memory cannot be allocated
+
+  while(iterations){
+    chunk = iterations > RD_SEGMENT_CHUNK ? RD_SEGMENT_CHUNK : iterations;
+
+    SLOW_EVENT_TIMER_START;
+    SRAM_hammer(seg, chunk);
+    result->ticks += TA0R;
+    TA0CTL &= ~MC_3; // halt timer
+
+    result->reads += chunk;
+    iterations -= chunk;
+  }
+
+  free((void*)SRAM_hammer);
+}
+
+uint32_t rd_reads_per_second(rd_result_s* result)
+{
+  if(!result->ticks)
+    return 0;
+  return (uint32_t)(((uint64_t)result->reads * ACLK_HZ) / result->ticks);
+}
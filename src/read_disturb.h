@@ -0,0 +1,62 @@
+//-------------------------------------------------------------------//
+// read_disturb.h
+//-------------------------------------------------------------------//
+// Functions for read disturb experiments, hammering words or segments
+// of flash with as many reads as possible
+// NOTES:
+// The hammer loops are unrolled and must be executed from RAM so the
+//    only flash reads on the bus are the ones aimed at the target
+// Throughput is measured on ACLK (~32KHz) in chunks short enough that
+//    the slow event timer never overflows
+// CODE_SECTION pragma is used to ensure that the functions are placed
+//    sequentially
+// SECTIONS MUST BE DEFINED IN LINKER COMMAND FILE
+// RESOURCE USAGE: Timer A0
+//-------------------------------------------------------------------//
+#pragma once
+#include <msp430.h>
+#include <stdint.h>
+#include "flash_operations.h"
+
+#pragma CODE_SECTION(rd_hammer_word, ".rd_hammer_word")
+#pragma CODE_SECTION(end_rd_hammer_word, ".rd_hammer_word")
+#pragma CODE_SECTION(rd_hammer_segment, ".rd_hammer_segment")
+#pragma CODE_SECTION(end_rd_hammer_segment, ".rd_hammer_segment")
+
+#define RD_WORD_READS_PER_ITERATION     16
+#define RD_SEGMENT_READS_PER_ITERATION  (F_SEGMENT_N_BYTES / 2)
+
+typedef struct rd_result_struct {
+  uint32_t reads; // reads of each hammered word so far
+  uint64_t ticks; // ACLK ticks spent performing them, days in segment mode
+} rd_result_s;
+
+void rd_hammer_word(uint16_t* target, uint16_t iterations);
+void end_rd_hammer_word(void);
+/*
+  Reads target RD_WORD_READS_PER_ITERATION times per iteration
+*/
+
+void rd_hammer_segment(f_segment_t seg, uint16_t iterations);
+void end_rd_hammer_segment(void);
+/*
+  Reads every word of seg once per iteration
+*/
+
+void rd_disturb_word(uint16_t* target, uint32_t reads, rd_result_s* result);
+/*
+  Function to read a single word at least reads times
+  Adds the reads performed and the time taken to result
+*/
+
+void rd_disturb_segment(f_segment_t seg, uint32_t reads, rd_result_s* result);
+/*
+  Function to read every word in a segment at least reads times
+  Adds the reads of each word and the time taken to result, the
+  flash sees RD_SEGMENT_READS_PER_ITERATION times as many reads
+*/
+
+uint32_t rd_reads_per_second(rd_result_s* result);
+/*
+  Reads of each hammered word per second
+*/
@@ -0,0 +1,191 @@
+#include "results_log.h"
+#include <msp430.h>
+#include <stdint.h>
+#include "flash_operations.h"
+#include "flash_statistics.h"
+#include "Serial.h"
+
+#define RL_RECORD(seg, slot) \
+  (((rl_record_s*)RL_BASE) + (uint32_t)(seg) * RL_RECORDS_PER_SEGMENT + (slot))
+
+static uint16_t rl_segment = 0;  // log segment currently appended to
+static uint16_t rl_slot = 0;     // next free record in rl_segment
+static uint16_t rl_sequence = 0; // sequence number of rl_segment
+
+static const char rl_hex[16] = "0123456789ABCDEF";
+
+
+static uint16_t rl_check(rl_record_s* record)
+{
+  uint16_t* words = (uint16_t*)record;
+  uint16_t check = 0x5AA5; // an all zero record is not valid
+
+  for(uint8_t i = 0; i < RL_RECORD_N_WORDS - 1; i++)
+    check ^= words[i];
+
+  return check;
+}
+
+static void rl_write(rl_record_s* record, rl_record_s* dst)
+// tag is written first so a torn record still marks its slot as used
+{
+  uint16_t* src_words = (uint16_t*)record;
+  uint16_t* dst_words = (uint16_t*)dst;
+
+  record->check = rl_check(record);
+
+  for(uint8_t i = 0; i < RL_RECORD_N_WORDS; i++)
+    f_word_write(src_words[i], dst_words + i);
+}
+
+static void rl_start_segment(uint16_t seg, uint16_t sequence)
+{
+  rl_record_s header = {0};
+
+  f_segment_erase((uint16_t*)RL_RECORD(seg, 0));
+
+  header.tag = (uint16_t)RL_TAG_HEADER << 8;
+  header.cycles_lo = sequence;
+  rl_write(&header, RL_RECORD(seg, 0));
+
+  rl_segment = seg;
+  rl_slot = 1;
+  rl_sequence = sequence;
+}
+
+
+void rl_init(void)
+{
+  rl_record_s* header;
+  uint8_t found = 0;
+
+  // newest segment is the valid header with the highest sequence number
+  for(uint16_t seg = 0; seg < RL_N_SEGMENTS; seg++){
+    header = RL_RECORD(seg, 0);
+    if((header->tag >> 8) != RL_TAG_HEADER || header->check != rl_check(header))
+      continue;
+
+    if(!found || (int16_t)(header->cycles_lo - rl_sequence) > 0){
+      rl_segment = seg;
+      rl_sequence = header->cycles_lo;
+      found = 1;
+    }
+  }
+
+  if(!found){
+    rl_start_segment(0, 0);
+    return;
+  }
+
+  // first erased slot in the newest segment is the end of the log
+  rl_slot = 1;
+  while(rl_slot < RL_RECORDS_PER_SEGMENT &&
+        (RL_RECORD(rl_segment, rl_slot)->tag >> 8) != RL_TAG_EMPTY)
+    rl_slot++;
+}
+
+void rl_append(rl_record_s* record)
+{
+  if(rl_slot >= RL_RECORDS_PER_SEGMENT) // ~25 ms erase once per 31 records
+    rl_start_segment((rl_segment + 1) % RL_N_SEGMENTS, rl_sequence + 1);
+
+  rl_write(record, RL_RECORD(rl_segment, rl_slot));
+  rl_slot++;
+}
+
+void rl_log_session(uint64_t chipID)
+{
+  rl_record_s record = {0};
+
+  record.tag = (uint16_t)RL_TAG_SESSION << 8;
+  for(uint8_t i = 0; i < 4; i++)
+    record.data[i] = (uint16_t)(chipID >> (16 * i));
+
+  rl_append(&record);
+}
+
+void rl_log_stats(uint32_t cycles, uint16_t segment, fs_stats_s* stats)
+{
+  rl_record_s record;
+
+  record.tag = ((uint16_t)RL_TAG_STATS << 8) | (segment & 0xFF);
+  record.cycles_lo = (uint16_t)cycles;
+  record.cycles_hi = (uint16_t)(cycles >> 16);
+  record.data[0] = stats->incorrect_bit_count;
+  record.data[1] = stats->unstable_bit_count;
+  record.data[2] = stats->partial_write_latency;
+  record.data[3] = stats->partial_erase_latency;
+
+  rl_append(&record);
+}
+
+void rl_log_failure(uint32_t cycle, uint16_t segment)
+{
+  rl_record_s record;
+
+  record.tag = ((uint16_t)RL_TAG_FAIL << 8) | (segment & 0xFF);
+  record.cycles_lo = (uint16_t)cycle;
+  record.cycles_hi = (uint16_t)(cycle >> 16);
+  record.data[0] = 0;
+  record.data[1] = 0;
+  record.data[2] = 0;
+  record.data[3] = 0;
+
+  rl_append(&record);
+}
+
+void rl_dump(void)
+// hex is built by hand, sprintf is far too slow for a whole log
+{
+  char line[2 + RL_RECORD_N_WORDS * 5 + 1];
+  rl_record_s* record;
+  uint16_t* words;
+  uint16_t seg;
+  uint16_t skipped = 0;
+  char* out;
+
+  Serial0_write("\n#LOG BEGIN\n");
+
+  // oldest segment is the one after the newest, wrapping around the ring
+  seg = rl_segment;
+  do {
+    seg = (seg + 1) % RL_N_SEGMENTS;
+    record = RL_RECORD(seg, 0);
+    if((record->tag >> 8) != RL_TAG_HEADER || record->check != rl_check(record))
+      continue; // never used or erased while wrapping
+
+    for(uint16_t slot = 1; slot < RL_RECORDS_PER_SEGMENT; slot++){
+      record = RL_RECORD(seg, slot);
+      if((record->tag >> 8) == RL_TAG_EMPTY)
+        break;
+      if(record->check != rl_check(record)){
+        skipped++;
+        continue;
+      }
+
+      words = (uint16_t*)record;
+      out = line;
+      *out++ = 'L';
+      for(uint8_t i = 0; i < RL_RECORD_N_WORDS; i++){
+        *out++ = ' ';
+        *out++ = rl_hex[words[i] >> 12];
+        *out++ = rl_hex[(words[i] >> 8) & 0xF];
+        *out++ = rl_hex[(words[i] >> 4) & 0xF];
+        *out++ = rl_hex[words[i] & 0xF];
+      }
+      *out++ = '\n';
+      *out = '\0';
+      Serial0_write(line);
+    }
+  } while(seg != rl_segment);
+
+  out = line;
+  *out++ = rl_hex[skipped >> 12];
+  *out++ = rl_hex[(skipped >> 8) & 0xF];
+  *out++ = rl_hex[(skipped >> 4) & 0xF];
+  *out++ = rl_hex[skipped & 0xF];
+  *out++ = '\n';
+  *out = '\0';
+  Serial0_write("#LOG END, torn records: 0x");
+  Serial0_write(line);
+}
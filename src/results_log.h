@@ -0,0 +1,67 @@
+//-------------------------------------------------------------------//
+// results_log.h
+//-------------------------------------------------------------------//
+// Append-only log of experiment results kept in flash so that nothing
+// is lost when the serial link is detached or the host logger dies.
+// NOTES:
+// The log lives in the upper half of bank C which is never stressed.
+// Records are appended around a ring of RL_N_SEGMENTS segments; when
+//    the ring wraps the oldest segment is erased, so every segment of
+//    the region sees the same number of erase cycles.
+// The first record of every log segment is a header holding a sequence
+//    number, this is how rl_init finds the newest segment after reset.
+// REGION MUST BE RESERVED AS LOGFLASH IN THE LINKER COMMAND FILE
+//-------------------------------------------------------------------//
+#pragma once
+#include <msp430.h>
+#include <stdint.h>
+#include "flash_operations.h"
+#include "flash_statistics.h"
+
+#define RL_BASE                 0x18400 /* upper half of bank C */
+#define RL_N_SEGMENTS           32
+#define RL_RECORD_N_WORDS       8
+#define RL_RECORDS_PER_SEGMENT  (F_SEGMENT_N_BYTES / (RL_RECORD_N_WORDS * 2))
+
+// record types, stored in the upper byte of the tag word
+#define RL_TAG_EMPTY    0xFF // erased flash
+#define RL_TAG_HEADER   0x01 // first record of a log segment, cycles = sequence
+#define RL_TAG_SESSION  0x02 // written once per boot, data = chip ID
+#define RL_TAG_STATS    0x03 // data = statistics of one bank segment
+#define RL_TAG_FAIL     0x04 // cycles = first failed verify of one bank segment
+
+typedef struct rl_record_struct {
+  uint16_t tag;       // record type in upper byte, bank segment # in lower
+  uint16_t cycles_lo; // PE cycle count of the checkpoint
+  uint16_t cycles_hi;
+  uint16_t data[4];
+  uint16_t check;     // XOR of the other words, detects torn records
+} rl_record_s;
+
+void rl_init(void);
+/*
+  Function to locate the end of the log after reset
+  Erases and starts a fresh log if no valid header is found
+*/
+
+void rl_append(rl_record_s* record);
+/*
+  Function to append one record to the log
+  Erases the next segment of the ring when the current one is full
+*/
+
+void rl_log_session(uint64_t chipID);
+
+void rl_log_stats(uint32_t cycles, uint16_t segment, fs_stats_s* stats);
+/*
+  Stores incorrect_bit_count, unstable_bit_count, partial_write_latency
+  and partial_erase_latency, the fields the experiment fills in
+*/
+
+void rl_log_failure(uint32_t cycle, uint16_t segment);
+
+void rl_dump(void);
+/*
+  Function to send every valid record over Serial0, oldest first
+  One line per record: "L" followed by the 8 record words in hex
+*/
@@ -0,0 +1,276 @@
+//-------------------------------------------------------------------//
+// fs_bench.c
+//-------------------------------------------------------------------//
+// Host benchmark for the statistics kernels in src/flash_statistics.c
+// The kernels are built unchanged against tools/host/msp430.h and run
+// over synthetic bank images held in memory.
+// - stuck bits: bits of a word that read opposite to the expected value
+// - noisy bits: bits that read back randomly on every read
+// Noise only depends on the word and how many times it has been read,
+// so any replacement kernel that reads each word in the same per word
+// order sees the same values. ref_check_bit_values is a plain
+// restatement of the kernel's semantics and is the oracle, a mismatch
+// is reported and makes the program exit with status 1.
+// The SECDED evaluation in src/flash_ecc.c is checked the same way,
+// on voted images from fs_check_bit_values_voted, against a decoder
+// that works bit by bit from the definition of the codes.
+//-------------------------------------------------------------------//
+#include <msp430.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "flash_operations.h"
+#include "flash_statistics.h"
+#include "flash_ecc.h"
+
+#define STAT_READ_COUNT 11 // must match src/flash_statistics.c
+#define BANK_N_WORDS    (F_BANK_N_SEGMENTS * F_SEGMENT_N_BYTES / 2)
+
+static uint16_t bank[BANK_N_WORDS];
+static uint16_t noise[BANK_N_WORDS];     // bits that read back randomly
+static uint16_t read_count[BANK_N_WORDS];
+static uint64_t noise_seed;
+
+static uint64_t mix64(uint64_t x)
+{
+  x += 0x9E3779B97F4A7C15ull;
+  x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+  x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+  return x ^ (x >> 31);
+}
+
+uint16_t host_flash_read(const uint16_t* ptr)
+{
+  size_t w = (size_t)(ptr - bank);
+  uint16_t value = bank[w];
+
+  if (noise[w]) {
+    uint64_t r = mix64(noise_seed ^ ((uint64_t)w << 20) ^ read_count[w]);
+    value ^= noise[w] & (uint16_t)r;
+  }
+  read_count[w]++;
+  return value;
+}
+
+static unsigned popcount16(uint16_t x)
+{
+  unsigned n = 0;
+  for (; x; x &= x - 1)
+    n++;
+  return n;
+}
+
+static void ref_check_bit_values(const uint16_t* seg, fs_stats_s* stats, uint16_t expected_val)
+{
+  stats->incorrect_bit_count = 0;
+  stats->unstable_bit_count = 0;
+
+  for (unsigned w = 0; w < F_SEGMENT_N_BYTES / 2; w++) {
+    unsigned votes[16] = {0};
+    uint16_t voted = 0;
+
+    for (unsigned r = 0; r < STAT_READ_COUNT; r++) {
+      uint16_t first = host_flash_read(seg + w);
+      uint16_t second = host_flash_read(seg + w);
+      for (unsigned b = 0; b < 16; b++)
+        votes[b] += (first >> b) & 1;
+      stats->unstable_bit_count += popcount16(first ^ second);
+    }
+    for (unsigned b = 0; b < 16; b++)
+      if (votes[b] > STAT_READ_COUNT / 2)
+        voted |= 1u << b;
+    stats->incorrect_bit_count += popcount16(voted ^ expected_val);
+  }
+}
+
+// each bit is stuck with probability stuck_density and noisy with
+// probability noise_density, returns the number of stuck bits
+static unsigned fill_bank(uint16_t expected_val, double stuck_density,
+                          double noise_density, uint64_t seed)
+{
+  unsigned stuck = 0;
+  uint64_t state = seed;
+
+  for (unsigned w = 0; w < BANK_N_WORDS; w++) {
+    uint16_t flips = 0;
+    uint16_t noisy = 0;
+    for (unsigned b = 0; b < 16; b++) {
+      double u;
+      state = mix64(state);
+      u = (state >> 11) * (1.0 / 9007199254740992.0);
+      if (u < stuck_density)
+        flips |= 1u << b;
+      else if (u < stuck_density + noise_density)
+        noisy |= 1u << b;
+    }
+    bank[w] = expected_val ^ flips;
+    noise[w] = noisy;
+    stuck += popcount16(flips);
+  }
+  return stuck;
+}
+
+static double now_ns(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+typedef void (*check_fn)(const uint16_t* seg, fs_stats_s* stats, uint16_t expected_val);
+
+static void run_fs(const uint16_t* seg, fs_stats_s* stats, uint16_t expected_val)
+{
+  fs_check_bit_values((f_segment_t)seg, stats, expected_val);
+}
+
+// runs kernel over the whole bank, totals go to out, returns ns/segment
+static double time_kernel(check_fn kernel, uint16_t expected_val, unsigned reps,
+                          unsigned long* incorrect, unsigned long* unstable)
+{
+  double start, elapsed = 0;
+  fs_stats_s stats;
+
+  for (unsigned r = 0; r < reps; r++) {
+    *incorrect = 0;
+    *unstable = 0;
+    memset(read_count, 0, sizeof(read_count));
+    noise_seed = 0x5EED;
+
+    start = now_ns();
+    for (unsigned s = 0; s < F_BANK_N_SEGMENTS; s++) {
+      kernel(bank + s * (F_SEGMENT_N_BYTES / 2), &stats, expected_val);
+      *incorrect += stats.incorrect_bit_count;
+      *unstable += stats.unstable_bit_count;
+    }
+    elapsed += now_ns() - start;
+  }
+  return elapsed / ((double)reps * F_BANK_N_SEGMENTS);
+}
+
+// bit i > 0 of a codeword has syndrome column i, bit 0 is the overall parity
+static void ref_ecc_evaluate(const uint16_t* voted, uint16_t expected_val, unsigned n,
+                             ecc_result_s* result)
+{
+  memset(result, 0, sizeof(*result));
+
+  for (unsigned start = 0; start + n <= F_SEGMENT_N_BYTES * 8; start += n) {
+    unsigned hamming = 0, parity = 0, weight = 0;
+    int decoded = -1;
+
+    for (unsigned i = 0; i < n; i++) {
+      unsigned bit = start + i;
+      if (((voted[bit / 16] ^ expected_val) >> (bit % 16)) & 1) {
+        hamming ^= i;
+        parity ^= 1;
+        weight++;
+      }
+    }
+    for (unsigned j = 0; j < n && parity; j++) // single error explaining the syndrome
+      if (j == hamming)
+        decoded = (int)j;
+
+    if (hamming == 0 && parity == 0)
+      weight == 0 ? result->clean++ : result->miscorrected++;
+    else if (decoded < 0)
+      result->detected++;
+    else
+      weight == 1 ? result->corrected++ : result->miscorrected++;
+  }
+}
+
+// returns 1 on a mismatch
+static int bench_ecc(unsigned reps)
+{
+  static const double stuck_densities[] = {0, 1e-4, 1e-3, 1e-2, 1e-1};
+  static uint16_t voted[BANK_N_WORDS];
+  int failed = 0;
+
+  printf("\n%-8s %-8s %12s %8s %10s %9s %13s %s\n", "code", "stuck", "ecc ns/seg",
+         "clean", "corrected", "detected", "miscorrected", "oracle");
+
+  for (uint8_t code = 0; code < ECC_N_CODES; code++)
+    for (size_t sd = 0; sd < sizeof(stuck_densities) / sizeof(stuck_densities[0]); sd++) {
+      unsigned long totals[4] = {0};
+      const char* verdict = "ok";
+      fs_stats_s stats;
+      ecc_result_s ecc, ref;
+      double start, elapsed = 0;
+
+      fill_bank(0x0000, stuck_densities[sd], 1e-3, 0xECC + code * 10 + sd);
+      memset(read_count, 0, sizeof(read_count));
+      noise_seed = 0x5EED;
+      for (unsigned s = 0; s < F_BANK_N_SEGMENTS; s++)
+        fs_check_bit_values_voted((f_segment_t)(bank + s * (F_SEGMENT_N_BYTES / 2)), &stats,
+                                  0x0000, voted + s * (F_SEGMENT_N_BYTES / 2));
+
+      for (unsigned s = 0; s < F_BANK_N_SEGMENTS; s++) {
+        const uint16_t* image = voted + s * (F_SEGMENT_N_BYTES / 2);
+
+        start = now_ns();
+        for (unsigned r = 0; r < reps; r++)
+          ecc_evaluate(image, 0x0000, code, &ecc);
+        elapsed += now_ns() - start;
+
+        ref_ecc_evaluate(image, 0x0000, ecc_codeword_bits(code), &ref);
+        if (memcmp(&ecc, &ref, sizeof(ecc)) != 0)
+          verdict = "MISMATCH";
+        totals[0] += ecc.clean;
+        totals[1] += ecc.corrected;
+        totals[2] += ecc.detected;
+        totals[3] += ecc.miscorrected;
+      }
+      if (strcmp(verdict, "ok") != 0)
+        failed = 1;
+
+      printf("(%u,%u)  %-8g %12.0f %8lu %10lu %9lu %13lu %s\n", ecc_codeword_bits(code),
+             ecc_data_bits(code), stuck_densities[sd], elapsed / ((double)reps * F_BANK_N_SEGMENTS), totals[0], totals[1], totals[2],
+             totals[3], verdict);
+    }
+
+  return failed;
+}
+
+int main(int argc, char** argv)
+{
+  static const uint16_t expected_vals[] = {0x0000, 0xFFFF, 0xA5A5};
+  static const double stuck_densities[] = {0, 1e-4, 1e-3, 1e-2, 1e-1};
+  static const double noise_densities[] = {0, 1e-3, 1e-2};
+  unsigned reps = argc > 1 ? (unsigned)strtoul(argv[1], NULL, 0) : 5;
+  int failed = 0;
+
+  if (reps == 0)
+    reps = 1;
+
+  printf("%-8s %-8s %-8s %12s %12s %10s %10s %s\n", "expected", "stuck", "noise",
+         "fs ns/seg", "ref ns/seg", "incorrect", "unstable", "oracle");
+
+  for (size_t e = 0; e < sizeof(expected_vals) / sizeof(expected_vals[0]); e++)
+    for (size_t sd = 0; sd < sizeof(stuck_densities) / sizeof(stuck_densities[0]); sd++)
+      for (size_t nd = 0; nd < sizeof(noise_densities) / sizeof(noise_densities[0]); nd++) {
+        uint16_t expected_val = expected_vals[e];
+        unsigned long fs_inc, fs_uns, ref_inc, ref_uns;
+        unsigned stuck = fill_bank(expected_val, stuck_densities[sd], noise_densities[nd],
+                                   0xB17 + e * 100 + sd * 10 + nd);
+        double fs_ns = time_kernel(run_fs, expected_val, reps, &fs_inc, &fs_uns);
+        double ref_ns = time_kernel(ref_check_bit_values, expected_val, reps, &ref_inc, &ref_uns);
+        const char* verdict = "ok";
+
+        if (fs_inc != ref_inc || fs_uns != ref_uns)
+          verdict = "MISMATCH";
+        else if (noise_densities[nd] == 0 && (ref_inc != stuck || ref_uns != 0))
+          verdict = "ORACLE WRONG"; // without noise the answer is known
+        if (strcmp(verdict, "ok") != 0)
+          failed = 1;
+
+        printf("0x%04X   %-8g %-8g %12.0f %12.0f %10lu %10lu %s\n", expected_val,
+               stuck_densities[sd], noise_densities[nd], fs_ns, ref_ns, fs_inc, fs_uns,
+               verdict);
+      }
+
+  failed |= bench_ecc(reps);
+
+  return failed;
+}
@@ -0,0 +1,503 @@
+//-------------------------------------------------------------------//
+// capture.cpp
+//-------------------------------------------------------------------//
+// Host side capture daemon for the flash experiment boards, replaces
+// the single board `cat | tee` of disp_serial.sh.
+// - Follows any number of serial devices at once with epoll
+// - Every text line is written as one record:
+//      <ISO 8601 time>\t<device>\t<line>
+// - Raw bank frames from src/raw_dump.h are written to a .raw file as
+//      <uint64 LE unix time in us><frame, header + segment bytes>
+// - Output is split per chip ID, taken from the "Subject Chip ID"
+//    header line. Lines seen before the header go to unknown-<tty>.
+// - Files are rotated to a new index once they pass the size limit
+// - Devices that disappear are closed and reopened when they come
+//    back, device arguments may be glob patterns. Use the stable
+//    /dev/serial/by-id/*-if02 names of the application UART, a board
+//    is only known by its path until its next header line.
+// Works on pseudo-terminals the same way as on real boards, e.g.
+//    socat pty,raw,echo=0,link=/tmp/board0 pty,raw,echo=0,link=/tmp/host0
+//    capture -o out /tmp/board0
+// capture/test_capture.py does this end to end (make test-capture)
+//-------------------------------------------------------------------//
+#include <cctype>
+#include <cerrno>
+#include <csignal>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <glob.h>
+#include <sys/epoll.h>
+#include <sys/stat.h>
+#include <termios.h>
+#include <unistd.h>
+
+namespace {
+
+// must match src/raw_dump.h
+constexpr size_t RAW_HEADER_N_BYTES = 8;
+constexpr size_t RAW_SEGMENT_N_BYTES = 512;
+constexpr size_t RAW_FRAME_N_BYTES = RAW_HEADER_N_BYTES + RAW_SEGMENT_N_BYTES;
+
+constexpr char CHIP_ID_TAG[] = "Subject Chip ID: 0x";
+
+volatile sig_atomic_t g_stop = 0;
+
+struct Options {
+  std::string out_dir = "logs";
+  size_t rotate_bytes = 16u << 20;
+  speed_t baud = B115200;
+  int rescan_ms = 1000;
+  bool echo = false;
+  std::vector<std::string> patterns;
+};
+
+struct Timestamp {
+  struct timespec ts;
+
+  static Timestamp now()
+  {
+    Timestamp t;
+    clock_gettime(CLOCK_REALTIME, &t.ts);
+    return t;
+  }
+
+  uint64_t micros() const
+  {
+    return (uint64_t)ts.tv_sec * 1000000u + (uint64_t)ts.tv_nsec / 1000u;
+  }
+
+  std::string iso() const
+  {
+    struct tm tm;
+    char buf[48];
+    gmtime_r(&ts.tv_sec, &tm);
+    size_t n = strftime(buf, sizeof(buf), "%Y-%m-%dT%H:%M:%S", &tm);
+    snprintf(buf + n, sizeof(buf) - n, ".%06ldZ", ts.tv_nsec / 1000);
+    return buf;
+  }
+};
+
+// One output stream, rotated to <base>.<index><ext> when it gets too big
+class RotatingFile {
+public:
+  RotatingFile(std::string base, std::string ext, size_t limit)
+    : base_(std::move(base)), ext_(std::move(ext)), limit_(limit) {}
+
+  ~RotatingFile() { close(); }
+
+  bool write(const void* data, size_t size)
+  {
+    if (!file_ || size_ >= limit_) {
+      if (!open_next())
+        return false;
+    }
+    if (fwrite(data, 1, size, file_) != size)
+      return false;
+    size_ += size;
+    return true;
+  }
+
+  void flush()
+  {
+    if (file_)
+      fflush(file_);
+  }
+
+private:
+  bool open_next()
+  {
+    close();
+    // continue after files left by an earlier run instead of overwriting
+    for (;;) {
+      char name[32];
+      snprintf(name, sizeof(name), ".%03u", index_++);
+      std::string path = base_ + name + ext_;
+      struct stat st;
+      if (stat(path.c_str(), &st) == 0 && (size_t)st.st_size >= limit_)
+        continue;
+      file_ = fopen(path.c_str(), "ab");
+      if (!file_) {
+        fprintf(stderr, "capture: cannot open %s: %s\n", path.c_str(), strerror(errno));
+        return false;
+      }
+      size_ = stat(path.c_str(), &st) == 0 ? st.st_size : 0;
+      return true;
+    }
+  }
+
+  void close()
+  {
+    if (file_)
+      fclose(file_);
+    file_ = nullptr;
+  }
+
+  std::string base_;
+  std::string ext_;
+  size_t limit_;
+  unsigned index_ = 0;
+  size_t size_ = 0;
+  FILE* file_ = nullptr;
+};
+
+class Sink {
+public:
+  explicit Sink(const Options& opt) : opt_(opt) {}
+
+  RotatingFile& text(const std::string& name) { return get(name, ".log"); }
+  RotatingFile& raw(const std::string& name) { return get(name, ".raw"); }
+
+  void flush()
+  {
+    for (auto& f : files_)
+      f.second->flush();
+  }
+
+private:
+  RotatingFile& get(const std::string& name, const char* ext)
+  {
+    std::string key = name + ext;
+    auto it = files_.find(key);
+    if (it == files_.end()) {
+      auto file = std::make_unique<RotatingFile>(opt_.out_dir + "/" + name, ext,
+                                                 opt_.rotate_bytes);
+      it = files_.emplace(key, std::move(file)).first;
+    }
+    return *it->second;
+  }
+
+  const Options& opt_;
+  std::map<std::string, std::unique_ptr<RotatingFile>> files_;
+};
+
+struct Board {
+  std::string path;
+  int fd = -1;
+  std::string chip;     // empty until the header is seen
+  std::string line;     // partial text line
+  std::string raw;      // partial raw frame, empty in text mode
+  std::vector<std::string> early; // records seen before the chip ID
+};
+
+class Capture {
+public:
+  explicit Capture(const Options& opt) : opt_(opt), sink_(opt) {}
+
+  int run()
+  {
+    epfd_ = epoll_create1(EPOLL_CLOEXEC);
+    if (epfd_ < 0) {
+      perror("capture: epoll_create1");
+      return 1;
+    }
+
+    rescan();
+    while (!g_stop) {
+      struct epoll_event events[16];
+      int n = epoll_wait(epfd_, events, 16, opt_.rescan_ms);
+      if (n < 0) {
+        if (errno == EINTR)
+          continue;
+        perror("capture: epoll_wait");
+        break;
+      }
+
+      for (int i = 0; i < n; i++) {
+        auto it = boards_.find(events[i].data.fd);
+        if (it == boards_.end())
+          continue;
+        if (!service(it->second))
+          drop(it);
+      }
+      sink_.flush();
+
+      if (n == 0 || Timestamp::now().micros() - last_scan_ >= (uint64_t)opt_.rescan_ms * 1000u)
+        rescan();
+    }
+
+    for (auto& b : boards_)
+      close(b.second.fd);
+    sink_.flush();
+    close(epfd_);
+    return 0;
+  }
+
+private:
+  void rescan()
+  {
+    last_scan_ = Timestamp::now().micros();
+    for (const auto& pattern : opt_.patterns) {
+      glob_t g;
+      if (glob(pattern.c_str(), GLOB_NOCHECK, nullptr, &g) != 0)
+        continue;
+      for (size_t i = 0; i < g.gl_pathc; i++)
+        open_board(g.gl_pathv[i]);
+      globfree(&g);
+    }
+  }
+
+  bool is_open(const std::string& path) const
+  {
+    for (const auto& b : boards_)
+      if (b.second.path == path)
+        return true;
+    return false;
+  }
+
+  void open_board(const std::string& path)
+  {
+    if (is_open(path))
+      return;
+
+    int fd = open(path.c_str(), O_RDONLY | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+    if (fd < 0)
+      return; // not there (yet), try again on the next scan
+
+    struct termios tio;
+    if (tcgetattr(fd, &tio) == 0) {
+      cfmakeraw(&tio);
+      cfsetispeed(&tio, opt_.baud);
+      cfsetospeed(&tio, opt_.baud);
+      tio.c_cflag |= CLOCAL | CREAD;
+      tio.c_cflag &= ~(PARENB | CSTOPB | CSIZE);
+      tio.c_cflag |= CS8;
+      tcsetattr(fd, TCSANOW, &tio);
+    }
+
+    struct epoll_event ev = {};
+    ev.events = EPOLLIN | EPOLLRDHUP;
+    ev.data.fd = fd;
+    if (epoll_ctl(epfd_, EPOLL_CTL_ADD, fd, &ev) != 0) {
+      close(fd);
+      return;
+    }
+
+    Board b;
+    b.path = path;
+    b.fd = fd;
+    // a board that re-enumerates on the same path keeps its chip ID, the
+    // header is only printed once per run
+    auto known = last_chip_.find(path);
+    if (known != last_chip_.end())
+      b.chip = known->second;
+    boards_.emplace(fd, std::move(b));
+    fprintf(stderr, "capture: following %s\n", path.c_str());
+  }
+
+  void drop(std::map<int, Board>::iterator it)
+  {
+    Board& b = it->second;
+    fprintf(stderr, "capture: lost %s\n", b.path.c_str());
+    if (!b.line.empty())
+      text_record(b, Timestamp::now(), b.line);
+    flush_early(b);
+    if (!b.chip.empty())
+      last_chip_[b.path] = b.chip;
+    epoll_ctl(epfd_, EPOLL_CTL_DEL, b.fd, nullptr);
+    close(b.fd);
+    boards_.erase(it);
+  }
+
+  // false when the device is gone
+  bool service(Board& b)
+  {
+    uint8_t buf[4096];
+    for (;;) {
+      ssize_t n = read(b.fd, buf, sizeof(buf));
+      if (n > 0) {
+        consume(b, Timestamp::now(), buf, (size_t)n);
+        continue;
+      }
+      if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+        return true;
+      if (n < 0 && errno == EINTR)
+        continue;
+      return false; // EOF, EIO (pty master closed) or unplugged
+    }
+  }
+
+  void consume(Board& b, const Timestamp& t, const uint8_t* data, size_t size)
+  {
+    for (size_t i = 0; i < size; i++) {
+      if (!b.raw.empty()) {
+        size_t take = RAW_FRAME_N_BYTES - b.raw.size();
+        if (take > size - i)
+          take = size - i;
+        b.raw.append((const char*)data + i, take);
+        i += take - 1;
+        if (b.raw.size() == RAW_FRAME_N_BYTES) {
+          raw_record(b, t);
+          b.raw.clear();
+        }
+        continue;
+      }
+
+      char c = (char)data[i];
+      if (c == '\n') {
+        if (!b.line.empty() && b.line.back() == '\r')
+          b.line.pop_back();
+        text_record(b, t, b.line);
+        b.line.clear();
+        continue;
+      }
+
+      b.line.push_back(c);
+      if (b.line == "RAW") { // frames always start at the start of a line
+        b.raw = b.line;
+        b.line.clear();
+      }
+    }
+  }
+
+  static std::string parse_chip(const std::string& line)
+  {
+    size_t pos = line.find(CHIP_ID_TAG);
+    if (pos == std::string::npos)
+      return "";
+    pos += sizeof(CHIP_ID_TAG) - 1;
+    size_t end = pos;
+    while (end < line.size() && isxdigit((unsigned char)line[end]))
+      end++;
+    if (end == pos)
+      return "";
+    return "chip-" + line.substr(pos, end - pos);
+  }
+
+  static std::string tty_name(const std::string& path)
+  {
+    size_t slash = path.rfind('/');
+    return "unknown-" + (slash == std::string::npos ? path : path.substr(slash + 1));
+  }
+
+  void text_record(Board& b, const Timestamp& t, const std::string& line)
+  {
+    std::string chip = parse_chip(line);
+    if (!chip.empty() && chip != b.chip) {
+      b.chip = chip;
+      last_chip_[b.path] = chip;
+    }
+
+    std::string record = t.iso() + "\t" + b.path + "\t" + line + "\n";
+    if (opt_.echo)
+      fwrite(record.data(), 1, record.size(), stdout);
+
+    if (b.chip.empty()) {
+      b.early.push_back(record);
+      if (b.early.size() > 256) // nothing to wait for, header was missed
+        flush_early(b);
+      return;
+    }
+    flush_early(b);
+    sink_.text(b.chip).write(record.data(), record.size());
+  }
+
+  void flush_early(Board& b)
+  {
+    if (b.early.empty())
+      return;
+    RotatingFile& f = b.chip.empty() ? sink_.text(tty_name(b.path)) : sink_.text(b.chip);
+    for (const auto& r : b.early)
+      f.write(r.data(), r.size());
+    b.early.clear();
+  }
+
+  void raw_record(Board& b, const Timestamp& t)
+  {
+    uint8_t stamp[8];
+    uint64_t us = t.micros();
+    for (int i = 0; i < 8; i++)
+      stamp[i] = (uint8_t)(us >> (8 * i));
+
+    RotatingFile& f = sink_.raw(b.chip.empty() ? tty_name(b.path) : b.chip);
+    f.write(stamp, sizeof(stamp));
+    f.write(b.raw.data(), b.raw.size());
+
+    char note[64];
+    snprintf(note, sizeof(note), "RAW frame segment %u", (unsigned)(uint8_t)b.raw[3]);
+    text_record(b, t, note);
+  }
+
+  const Options& opt_;
+  Sink sink_;
+  int epfd_ = -1;
+  uint64_t last_scan_ = 0;
+  std::map<int, Board> boards_;
+  std::map<std::string, std::string> last_chip_;
+};
+
+speed_t parse_baud(long baud)
+{
+  switch (baud) {
+    case 9600: return B9600;
+    case 19200: return B19200;
+    case 38400: return B38400;
+    case 57600: return B57600;
+    case 115200: return B115200;
+    case 230400: return B230400;
+    case 460800: return B460800;
+    case 921600: return B921600;
+    default: return 0;
+  }
+}
+
+void usage()
+{
+  fprintf(stderr,
+          "usage: capture [-o dir] [-s rotate_bytes] [-b baud] [-i rescan_ms] [-e] device...\n"
+          "  device may be a glob pattern, quote it: '/dev/serial/by-id/*-if02'\n"
+          "  -e  echo records to stdout\n");
+}
+
+void on_signal(int) { g_stop = 1; }
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+  Options opt;
+  int c;
+  while ((c = getopt(argc, argv, "o:s:b:i:eh")) != -1) {
+    switch (c) {
+      case 'o': opt.out_dir = optarg; break;
+      case 's': opt.rotate_bytes = strtoull(optarg, nullptr, 0); break;
+      case 'b':
+        opt.baud = parse_baud(strtol(optarg, nullptr, 10));
+        if (!opt.baud) {
+          fprintf(stderr, "capture: unsupported baud rate %s\n", optarg);
+          return 2;
+        }
+        break;
+      case 'i': opt.rescan_ms = atoi(optarg); break;
+      case 'e': opt.echo = true; break;
+      default: usage(); return 2;
+    }
+  }
+  for (int i = optind; i < argc; i++)
+    opt.patterns.push_back(argv[i]);
+  if (opt.patterns.empty() || opt.rotate_bytes == 0 || opt.rescan_ms <= 0) {
+    usage();
+    return 2;
+  }
+
+  if (mkdir(opt.out_dir.c_str(), 0755) != 0 && errno != EEXIST) {
+    fprintf(stderr, "capture: cannot create %s: %s\n", opt.out_dir.c_str(), strerror(errno));
+    return 1;
+  }
+
+  struct sigaction sa = {};
+  sa.sa_handler = on_signal;
+  sigaction(SIGINT, &sa, nullptr);
+  sigaction(SIGTERM, &sa, nullptr);
+  signal(SIGPIPE, SIG_IGN);
+
+  return Capture(opt).run();
+}
@@ -0,0 +1,216 @@
+#!/usr/bin/env python3
+#-------------------------------------------------------------------#
+# test_capture.py
+#-------------------------------------------------------------------#
+# End to end test of the capture daemon against pseudo-terminals.
+# Each fake board is a pty whose slave is reached through a symlink in
+# a scratch directory, the daemon follows the symlinks with a glob.
+# Covers:
+# - records split per chip ID, lines before the header kept
+# - raw frames cut out of the text stream, including frames holding
+#    '\n' bytes, and text after a frame left intact
+# - rotation to a new file index once the size limit is passed
+# - a board that disappears and comes back on the same path is
+#    reopened and keeps its chip ID
+# usage: test_capture.py <path to capture binary>
+# Exits with status 1 and prints the failed check on failure.
+#-------------------------------------------------------------------#
+import glob
+import os
+import pty
+import shutil
+import signal
+import subprocess
+import sys
+import tempfile
+import time
+import tty
+
+ROTATE_BYTES = 4096
+RESCAN_MS = 100
+TIMEOUT = 5.0
+
+
+class Board:
+    """A fake board, the test writes to the master side"""
+
+    def __init__(self, link):
+        self.link = link
+        self.master = None
+        self.plug()
+
+    def plug(self):
+        self.master, slave = pty.openpty()
+        tty.setraw(slave) # no echo or newline translation before capture opens it
+        self.slave = slave
+        if os.path.lexists(self.link):
+            os.unlink(self.link)
+        os.symlink(os.ttyname(slave), self.link)
+
+    def release_slave(self):
+        # only capture may hold the slave, so that unplugging gives it EIO
+        if self.slave is not None:
+            os.close(self.slave)
+            self.slave = None
+
+    def unplug(self):
+        self.release_slave()
+        os.close(self.master)
+        self.master = None
+        os.unlink(self.link)
+
+    def send(self, data):
+        if isinstance(data, str):
+            data = data.encode()
+        while data:
+            n = os.write(self.master, data)
+            data = data[n:]
+
+
+def wait_for(what, check):
+    deadline = time.time() + TIMEOUT
+    while time.time() < deadline:
+        if check():
+            return
+        time.sleep(0.02)
+    fail("timed out waiting for " + what)
+
+
+def fail(message):
+    print("FAIL: " + message)
+    sys.exit(1)
+
+
+def expect(condition, message):
+    if not condition:
+        fail(message)
+
+
+def read_text(out, name):
+    data = b""
+    for path in sorted(glob.glob(os.path.join(out, name + ".*.log"))):
+        with open(path, "rb") as f:
+            data += f.read()
+    return data.decode()
+
+
+def lines_of(out, name):
+    # the line part of every record, time and device dropped
+    return [r.split("\t", 2)[2] for r in read_text(out, name).splitlines()]
+
+
+class Daemon:
+    def __init__(self, binary, out, pattern):
+        self.stderr_path = os.path.join(os.path.dirname(out), "capture.stderr")
+        self.stderr = open(self.stderr_path, "w")
+        self.proc = subprocess.Popen(
+            [binary, "-o", out, "-s", str(ROTATE_BYTES), "-i", str(RESCAN_MS), pattern],
+            stderr=self.stderr)
+
+    def messages(self):
+        with open(self.stderr_path) as f:
+            return f.read()
+
+    def wait_following(self, board, count=1):
+        message = "following " + board.link
+        wait_for(message, lambda: self.messages().count(message) >= count)
+        board.release_slave()
+
+    def stop(self):
+        self.proc.send_signal(signal.SIGTERM)
+        try:
+            status = self.proc.wait(TIMEOUT)
+        except subprocess.TimeoutExpired:
+            self.proc.kill()
+            fail("capture did not stop on SIGTERM")
+        self.stderr.close()
+        expect(status == 0, "capture exited with status %d" % status)
+
+
+def raw_frame(segment, cycles):
+    header = b"RAW" + bytes([segment]) + cycles.to_bytes(4, "little")
+    body = bytes((i * 7 + segment) & 0xFF for i in range(512)) # holds '\n' and "RAW"
+    return header + body
+
+
+def main():
+    if len(sys.argv) != 2:
+        print("usage: test_capture.py <capture binary>")
+        return 2
+    binary = os.path.abspath(sys.argv[1])
+
+    scratch = tempfile.mkdtemp(prefix="capture-test-")
+    try:
+        out = os.path.join(scratch, "out")
+        devices = os.path.join(scratch, "dev")
+        os.mkdir(devices)
+
+        board0 = Board(os.path.join(devices, "board0"))
+        board1 = Board(os.path.join(devices, "board1"))
+        daemon = Daemon(binary, out, os.path.join(devices, "board*"))
+        daemon.wait_following(board0)
+        daemon.wait_following(board1)
+
+        # chip ID splitting, the first line comes before the header
+        board0.send("boot board0\n- Subject Chip ID: 0x00000000000000AA\nline a0\n")
+        board1.send("boot board1\r\n- Subject Chip ID: 0x00000000000000BB\r\nline b0\r\n")
+        wait_for("chip files", lambda: "line a0" in read_text(out, "chip-00000000000000AA")
+                 and "line b0" in read_text(out, "chip-00000000000000BB"))
+        expect(lines_of(out, "chip-00000000000000AA") ==
+               ["boot board0", "- Subject Chip ID: 0x00000000000000AA", "line a0"],
+               "board0 records")
+        expect(lines_of(out, "chip-00000000000000BB") ==
+               ["boot board1", "- Subject Chip ID: 0x00000000000000BB", "line b0"],
+               "board1 records, \\r\\n must be stripped")
+        expect(not glob.glob(os.path.join(out, "unknown-*")), "no unknown-<tty> files")
+
+        # raw frames, split across writes and followed by text
+        frames = [raw_frame(3, 200000), raw_frame(4, 200000)]
+        stream = frames[0] + frames[1] + b"after raw\n"
+        board0.send(stream[:100])
+        time.sleep(0.05)
+        board0.send(stream[100:])
+        raw_path = os.path.join(out, "chip-00000000000000AA.000.raw")
+        wait_for("raw frames", lambda: os.path.exists(raw_path)
+                 and os.path.getsize(raw_path) == 2 * (8 + 520)
+                 and "after raw" in read_text(out, "chip-00000000000000AA"))
+        with open(raw_path, "rb") as f:
+            raw = f.read()
+        expect(raw[8:528] == frames[0] and raw[536:] == frames[1], "raw frame bytes")
+        expect(lines_of(out, "chip-00000000000000AA")[3:] ==
+               ["RAW frame segment 3", "RAW frame segment 4", "after raw"],
+               "text around raw frames")
+
+        # rotation
+        expected = ["rotate %04d %s" % (i, "x" * 40) for i in range(300)]
+        board1.send("".join(line + "\n" for line in expected))
+        wait_for("rotated records", lambda: expected[-1] in read_text(out, "chip-00000000000000BB"))
+        files = sorted(glob.glob(os.path.join(out, "chip-00000000000000BB.*.log")))
+        expect(len(files) > 2, "log was not rotated")
+        record_max = max(len(r) + 1 for r in read_text(out, "chip-00000000000000BB").splitlines())
+        for path in files:
+            expect(os.path.getsize(path) < ROTATE_BYTES + record_max, path + " over the limit")
+        expect(lines_of(out, "chip-00000000000000BB")[3:] == expected, "rotated records in order")
+
+        # re-enumeration, the board comes back without printing its header
+        board0.unplug()
+        wait_for("lost board0", lambda: "lost " + board0.link in daemon.messages())
+        board0.plug()
+        daemon.wait_following(board0, 2)
+        board0.send("after replug\n")
+        wait_for("record after replug",
+                 lambda: "after replug" in read_text(out, "chip-00000000000000AA"))
+        expect(not glob.glob(os.path.join(out, "unknown-*")), "replugged board lost its chip ID")
+
+        daemon.stop()
+        board1.unplug()
+        board0.unplug()
+    finally:
+        shutil.rmtree(scratch, ignore_errors=True)
+
+    print("capture: all checks passed")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
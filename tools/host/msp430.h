@@ -0,0 +1,72 @@
+#pragma once
+#include <stdint.h>
+//-------------------------------------------------------------------//
+// msp430.h (host stub)
+//-------------------------------------------------------------------//
+// Stand-in for the TI device header so the firmware sources in src/
+// can be compiled with the native compiler.
+// NOTES:
+// Peripheral registers are plain variables defined in msp430_stub.c,
+//    nothing drives them. Routines that poll the flash controller for
+//    WAIT never return on the host.
+// flash_trace.h is bypassed by defining FT_RECORD here.
+// Flash reads in the statistics kernels go through FS_READ_WORD so the
+//    host program can serve them from memory and inject read noise.
+//    host_flash_read must be defined by the program being linked.
+// Only the names used by the sources built on the host are provided,
+//    values match the MSP430F5529 header.
+//-------------------------------------------------------------------//
+
+extern volatile uint16_t FCTL1, FCTL3, FCTL4;
+extern volatile uint16_t TA0CTL, TA0R, TA1CTL, TA1R;
+
+uint16_t host_flash_read(const uint16_t* ptr);
+#define FS_READ_WORD(ptr) host_flash_read(ptr)
+
+// flash controller events are not traced on the host
+#define FT_START 0
+#define FT_RECORD(op, address, start) ((void)(address), (void)(start))
+
+#define __no_operation()  ((void)0)
+#define __disable_interrupt() ((void)0)
+#define __get_interrupt_state() ((uint16_t)0)
+#define __set_interrupt_state(state) ((void)(state))
+
+#define BIT0  (0x0001)
+#define BIT1  (0x0002)
+#define BIT2  (0x0004)
+#define BIT3  (0x0008)
+#define BIT4  (0x0010)
+#define BIT5  (0x0020)
+#define BIT6  (0x0040)
+#define BIT7  (0x0080)
+#define BIT8  (0x0100)
+#define BIT9  (0x0200)
+#define BITA  (0x0400)
+#define BITB  (0x0800)
+#define BITC  (0x1000)
+#define BITD  (0x2000)
+#define BITE  (0x4000)
+#define BITF  (0x8000)
+
+// flash controller
+#define FWPW     (0xA500)
+#define ERASE    (0x0002)
+#define MERAS    (0x0004)
+#define WRT      (0x0040)
+#define BLKWRT   (0x0080)
+#define BUSY     (0x0001)
+#define KEYV     (0x0002)
+#define ACCVIFG  (0x0004)
+#define WAIT     (0x0008)
+#define LOCK     (0x0010)
+#define EMEX     (0x0020)
+#define LOCKA    (0x0040)
+
+// timer A
+#define TACLR    (0x0004)
+#define MC_2     (0x0020)
+#define MC_3     (0x0030)
+#define ID__1    (0x0000)
+#define TASSEL_1 (0x0100)
+#define TASSEL_2 (0x0200)
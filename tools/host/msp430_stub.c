@@ -0,0 +1,4 @@
+#include <msp430.h>
+
+volatile uint16_t FCTL1, FCTL3, FCTL4;
+volatile uint16_t TA0CTL, TA0R, TA1CTL, TA1R;
@@ -0,0 +1,625 @@
+//-------------------------------------------------------------------//
+// rstore.cpp
+//-------------------------------------------------------------------//
+// Append-only columnar store for experiment results.
+// A store is a directory with one file per column:
+//    chip_id.u64  cycles.u32  segment.u16
+//    <fs_stats_s field>.u16 for every field of fs_stats_s
+// plus index.bin, a sorted array of (chip ID, cycle count) -> row range
+// entries. Rows of one checkpoint of one chip are appended together,
+// so the index has about one entry per 64 rows and stays small.
+// Queries mmap the columns and only touch the rows the index points
+// at, nothing is parsed or copied.
+// Ingest reads firmware logs, raw or written by tools/capture:
+// - the text statistics report printed at every checkpoint
+// - "L" lines of a results log dump (src/results_log.h)
+// Rows already in the store (same chip, cycles and segment) are
+// skipped, so logs can be ingested again safely.
+// USAGE:
+//    rstore ingest STORE LOG...
+//    rstore query STORE [--chip ID] [--cycles N] [--segment S]
+//                       [--field NAME] [--summary]
+//    rstore info STORE
+//    rstore synth STORE CHIPS     synthetic rows for timing checks
+//-------------------------------------------------------------------//
+#include <algorithm>
+#include <chrono>
+#include <cerrno>
+#include <cinttypes>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <set>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr unsigned FS_N_FIELDS = 6;
+
+// order and names of fs_stats_s in src/flash_statistics.h
+const char* const FS_FIELDS[FS_N_FIELDS] = {
+  "incorrect_bit_count", "unstable_bit_count", "write_latency",
+  "erase_latency", "partial_write_latency", "partial_erase_latency",
+};
+
+constexpr uint16_t FIELD_UNSET = 0xFFFF; // also FS_PARTIAL_*_FAIL
+
+struct Row {
+  uint64_t chip;
+  uint32_t cycles;
+  uint16_t segment;
+  uint16_t field[FS_N_FIELDS];
+};
+
+struct IndexEntry {
+  uint64_t chip;
+  uint32_t cycles;
+  uint32_t count;
+  uint64_t first_row;
+
+  bool operator<(const IndexEntry& o) const
+  {
+    return std::tie(chip, cycles, first_row) < std::tie(o.chip, o.cycles, o.first_row);
+  }
+};
+
+// read only mapping of one column file
+template <typename T>
+class Column {
+public:
+  Column() = default;
+  Column(const Column&) = delete;
+  Column& operator=(const Column&) = delete;
+  ~Column() { unmap(); }
+
+  bool map(const std::string& path)
+  {
+    unmap();
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+      return errno == ENOENT; // empty store
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+      close(fd);
+      return false;
+    }
+    size_ = st.st_size / sizeof(T);
+    if (size_) {
+      void* p = mmap(nullptr, size_ * sizeof(T), PROT_READ, MAP_SHARED, fd, 0);
+      if (p == MAP_FAILED) {
+        close(fd);
+        return false;
+      }
+      data_ = static_cast<const T*>(p);
+      madvise(p, size_ * sizeof(T), MADV_RANDOM);
+    }
+    close(fd);
+    return true;
+  }
+
+  size_t size() const { return size_; }
+  const T& operator[](size_t i) const { return data_[i]; }
+  const T* begin() const { return data_; }
+  const T* end() const { return data_ + size_; }
+
+private:
+  void unmap()
+  {
+    if (data_)
+      munmap(const_cast<T*>(data_), size_ * sizeof(T));
+    data_ = nullptr;
+    size_ = 0;
+  }
+
+  const T* data_ = nullptr;
+  size_t size_ = 0;
+};
+
+class Store {
+public:
+  explicit Store(std::string dir) : dir_(std::move(dir)) {}
+
+  bool open_read()
+  {
+    bool ok = chip_.map(path("chip_id.u64")) && cycles_.map(path("cycles.u32")) &&
+              segment_.map(path("segment.u16")) && index_.map(path("index.bin"));
+    for (unsigned f = 0; f < FS_N_FIELDS; f++)
+      ok = ok && field_[f].map(path(std::string(FS_FIELDS[f]) + ".u16"));
+    if (!ok) {
+      fprintf(stderr, "rstore: cannot map %s\n", dir_.c_str());
+      return false;
+    }
+    // a torn append leaves some columns longer, only full rows count
+    rows_ = std::min({chip_.size(), (size_t)cycles_.size(), segment_.size()});
+    for (unsigned f = 0; f < FS_N_FIELDS; f++)
+      rows_ = std::min(rows_, field_[f].size());
+    return true;
+  }
+
+  size_t rows() const { return rows_; }
+  const Column<IndexEntry>& index() const { return index_; }
+
+  Row row(uint64_t i) const
+  {
+    Row r;
+    r.chip = chip_[i];
+    r.cycles = cycles_[i];
+    r.segment = segment_[i];
+    for (unsigned f = 0; f < FS_N_FIELDS; f++)
+      r.field[f] = field_[f][i];
+    return r;
+  }
+
+  uint16_t segment(uint64_t i) const { return segment_[i]; }
+  uint16_t field(unsigned f, uint64_t i) const { return field_[f][i]; }
+
+  // index entries for a chip, or every entry when chip is not given
+  std::pair<const IndexEntry*, const IndexEntry*> chip_range(bool has_chip, uint64_t chip) const
+  {
+    if (!has_chip)
+      return {index_.begin(), index_.end()};
+    auto lo = std::lower_bound(index_.begin(), index_.end(), chip,
+                               [](const IndexEntry& e, uint64_t c) { return e.chip < c; });
+    auto hi = std::upper_bound(lo, index_.end(), chip,
+                               [](uint64_t c, const IndexEntry& e) { return c < e.chip; });
+    return {lo, hi};
+  }
+
+  // appends rows, skipping ones already stored; returns rows written
+  size_t append(const std::vector<Row>& rows)
+  {
+    if (mkdir(dir_.c_str(), 0755) != 0 && errno != EEXIST) {
+      fprintf(stderr, "rstore: cannot create %s: %s\n", dir_.c_str(), strerror(errno));
+      return 0;
+    }
+    if (!open_read())
+      return 0;
+    truncate_columns();
+
+    std::set<std::tuple<uint64_t, uint32_t, uint16_t>> seen;
+    std::vector<Row> fresh;
+    for (const Row& r : rows) {
+      if (!seen.emplace(r.chip, r.cycles, r.segment).second || stored(r))
+        continue;
+      fresh.push_back(r);
+    }
+
+    // group checkpoints together so each gets a single index entry
+    std::stable_sort(fresh.begin(), fresh.end(), [](const Row& a, const Row& b) {
+      return std::tie(a.chip, a.cycles) < std::tie(b.chip, b.cycles);
+    });
+
+    std::vector<IndexEntry> index(index_.begin(), index_.end());
+    uint64_t next = rows_;
+    for (size_t i = 0; i < fresh.size();) {
+      size_t j = i;
+      while (j < fresh.size() && fresh[j].chip == fresh[i].chip &&
+             fresh[j].cycles == fresh[i].cycles)
+        j++;
+      index.push_back(IndexEntry{fresh[i].chip, fresh[i].cycles, (uint32_t)(j - i), next});
+      next += j - i;
+      i = j;
+    }
+    std::sort(index.begin(), index.end());
+
+    bool ok = append_column<uint64_t>("chip_id.u64", fresh, [](const Row& r) { return r.chip; }) &&
+              append_column<uint32_t>("cycles.u32", fresh, [](const Row& r) { return r.cycles; }) &&
+              append_column<uint16_t>("segment.u16", fresh, [](const Row& r) { return r.segment; });
+    for (unsigned f = 0; f < FS_N_FIELDS && ok; f++)
+      ok = append_column<uint16_t>(std::string(FS_FIELDS[f]) + ".u16", fresh,
+                                   [f](const Row& r) { return r.field[f]; });
+    if (!ok)
+      return 0;
+
+    // index is replaced last and atomically, it never points past the columns
+    std::string tmp = path("index.bin.tmp");
+    FILE* fp = fopen(tmp.c_str(), "wb");
+    if (!fp || fwrite(index.data(), sizeof(IndexEntry), index.size(), fp) != index.size() ||
+        fclose(fp) != 0 || rename(tmp.c_str(), path("index.bin").c_str()) != 0) {
+      fprintf(stderr, "rstore: cannot write index\n");
+      return 0;
+    }
+    return fresh.size();
+  }
+
+private:
+  std::string path(const std::string& name) const { return dir_ + "/" + name; }
+
+  bool stored(const Row& r) const
+  {
+    auto range = chip_range(true, r.chip);
+    for (auto e = range.first; e != range.second; ++e) {
+      if (e->cycles != r.cycles)
+        continue;
+      for (uint64_t i = e->first_row; i < e->first_row + e->count && i < rows_; i++)
+        if (segment_[i] == r.segment)
+          return true;
+    }
+    return false;
+  }
+
+  void truncate_columns()
+  {
+    auto cut = [&](const std::string& name, size_t width) {
+      ::truncate(path(name).c_str(), (off_t)(rows_ * width));
+    };
+    cut("chip_id.u64", 8);
+    cut("cycles.u32", 4);
+    cut("segment.u16", 2);
+    for (unsigned f = 0; f < FS_N_FIELDS; f++)
+      cut(std::string(FS_FIELDS[f]) + ".u16", 2);
+  }
+
+  template <typename T, typename Get>
+  bool append_column(const std::string& name, const std::vector<Row>& rows, Get get)
+  {
+    std::vector<T> values;
+    values.reserve(rows.size());
+    for (const Row& r : rows)
+      values.push_back((T)get(r));
+
+    FILE* fp = fopen(path(name).c_str(), "ab");
+    if (!fp || fwrite(values.data(), sizeof(T), values.size(), fp) != values.size() ||
+        fclose(fp) != 0) {
+      fprintf(stderr, "rstore: cannot append %s\n", name.c_str());
+      return false;
+    }
+    return true;
+  }
+
+  std::string dir_;
+  size_t rows_ = 0;
+  Column<uint64_t> chip_;
+  Column<uint32_t> cycles_;
+  Column<uint16_t> segment_;
+  Column<uint16_t> field_[FS_N_FIELDS];
+  Column<IndexEntry> index_;
+};
+
+//-------------------------------------------------------------------//
+// log parsing
+//-------------------------------------------------------------------//
+
+class LogParser {
+public:
+  explicit LogParser(std::vector<Row>& out) : out_(out) {}
+
+  void line(std::string text)
+  {
+    size_t tab = text.rfind('\t'); // capture records: time \t device \t line
+    if (tab != std::string::npos)
+      text.erase(0, tab + 1);
+    if (!text.empty() && text.back() == '\r')
+      text.pop_back();
+
+    if (!text.empty() && text[0] == '#')
+      return; // machine lines (#OK, #FT, #FAIL, ...) hold no statistics
+
+    size_t pos;
+    if ((pos = text.find("Subject Chip ID: 0x")) != std::string::npos) {
+      finish();
+      chip_ = strtoull(text.c_str() + pos + 19, nullptr, 16);
+      has_chip_ = true;
+    } else if ((pos = text.find("Cycle count:")) != std::string::npos) {
+      finish();
+      cycles_ = strtoul(text.c_str() + pos + 12, nullptr, 10);
+      has_cycles_ = true;
+    } else if (text.find("Read count") != std::string::npos) {
+      finish();
+      has_cycles_ = false; // read disturb reports are not cycle checkpoints
+    } else if ((pos = text.find("Segment # ")) != std::string::npos) {
+      finish();
+      pending_ = true;
+      row_ = Row{};
+      row_.segment = (uint16_t)strtoul(text.c_str() + pos + 10, nullptr, 10);
+      std::fill(std::begin(row_.field), std::end(row_.field), FIELD_UNSET);
+    } else if (text.size() > 2 && text[0] == 'L' && text[1] == ' ') {
+      finish();
+      log_record(text);
+    } else if (pending_) {
+      field(text, "incorrect bit count", 0);
+      field(text, "unstable bit count", 1);
+      field(text, "partial write latency", 4);
+      field(text, "partial erase latency", 5);
+    }
+  }
+
+  void finish()
+  {
+    if (!pending_)
+      return;
+    pending_ = false;
+    if (has_chip_ && has_cycles_) {
+      row_.chip = chip_;
+      row_.cycles = cycles_;
+      out_.push_back(row_);
+    } else {
+      skipped_++;
+    }
+  }
+
+  size_t skipped() const { return skipped_; }
+
+private:
+  void field(const std::string& text, const char* name, unsigned f)
+  {
+    size_t pos = text.find(name);
+    if (pos == std::string::npos)
+      return;
+    pos = text.find(':', pos);
+    if (pos != std::string::npos)
+      row_.field[f] = (uint16_t)strtoul(text.c_str() + pos + 1, nullptr, 10);
+  }
+
+  // "L" + 8 hex words of an rl_record_s, see src/results_log.h
+  void log_record(const std::string& text)
+  {
+    uint16_t w[8];
+    const char* p = text.c_str() + 1;
+    for (int i = 0; i < 8; i++) {
+      char* end;
+      w[i] = (uint16_t)strtoul(p, &end, 16);
+      if (end == p)
+        return;
+      p = end;
+    }
+    uint16_t check = 0x5AA5;
+    for (int i = 0; i < 7; i++)
+      check ^= w[i];
+    if (check != w[7])
+      return;
+
+    switch (w[0] >> 8) {
+      case 0x02: // RL_TAG_SESSION
+        log_chip_ = (uint64_t)w[3] | (uint64_t)w[4] << 16 | (uint64_t)w[5] << 32 |
+                    (uint64_t)w[6] << 48;
+        has_log_chip_ = true;
+        break;
+      case 0x03: { // RL_TAG_STATS
+        if (!has_log_chip_) {
+          skipped_++;
+          break;
+        }
+        Row r{};
+        r.chip = log_chip_;
+        r.cycles = (uint32_t)w[1] | (uint32_t)w[2] << 16;
+        r.segment = w[0] & 0xFF;
+        std::fill(std::begin(r.field), std::end(r.field), FIELD_UNSET);
+        r.field[0] = w[3];
+        r.field[1] = w[4];
+        r.field[4] = w[5];
+        r.field[5] = w[6];
+        out_.push_back(r);
+        break;
+      }
+      default:
+        break;
+    }
+  }
+
+  std::vector<Row>& out_;
+  Row row_{};
+  bool pending_ = false;
+  uint64_t chip_ = 0;
+  bool has_chip_ = false;
+  uint32_t cycles_ = 0;
+  bool has_cycles_ = false;
+  uint64_t log_chip_ = 0;
+  bool has_log_chip_ = false;
+  size_t skipped_ = 0;
+};
+
+//-------------------------------------------------------------------//
+// commands
+//-------------------------------------------------------------------//
+
+double ms_since(std::chrono::steady_clock::time_point t)
+{
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t).count();
+}
+
+int cmd_ingest(const std::string& dir, int argc, char** argv)
+{
+  std::vector<Row> rows;
+  size_t skipped = 0;
+
+  for (int i = 0; i < argc; i++) {
+    std::ifstream in(argv[i]);
+    if (!in) {
+      fprintf(stderr, "rstore: cannot read %s\n", argv[i]);
+      return 1;
+    }
+    LogParser parser(rows);
+    std::string text;
+    while (std::getline(in, text))
+      parser.line(text);
+    parser.finish();
+    skipped += parser.skipped();
+  }
+
+  Store store(dir);
+  size_t written = store.append(rows);
+  printf("parsed %zu rows, stored %zu new, skipped %zu without chip ID or cycle count\n",
+         rows.size(), written, skipped);
+  return 0;
+}
+
+int cmd_synth(const std::string& dir, unsigned chips)
+{
+  std::vector<Row> rows;
+  uint64_t x = 88172645463325252ull;
+  for (unsigned c = 0; c < chips; c++)
+    for (uint32_t cycles = 0; cycles <= 2000000; cycles += 200000)
+      for (uint16_t s = 0; s < 64; s++) {
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+        Row r{};
+        r.chip = 0x1000000 + c;
+        r.cycles = cycles;
+        r.segment = s;
+        r.field[0] = (uint16_t)((x & 0xFF) * cycles / 2000000);
+        r.field[1] = (uint16_t)(((x >> 8) & 0x3FF) * cycles / 2000000);
+        r.field[2] = r.field[3] = FIELD_UNSET;
+        r.field[4] = (uint16_t)(30 + ((x >> 20) & 0xF));
+        r.field[5] = FIELD_UNSET;
+        rows.push_back(r);
+      }
+  Store store(dir);
+  printf("stored %zu rows\n", store.append(rows));
+  return 0;
+}
+
+int cmd_info(const std::string& dir)
+{
+  Store store(dir);
+  if (!store.open_read())
+    return 1;
+  std::set<uint64_t> chips;
+  for (const auto& e : store.index())
+    chips.insert(e.chip);
+  printf("rows: %zu\nindex entries: %zu\nchips: %zu\n", store.rows(), store.index().size(),
+         chips.size());
+  return 0;
+}
+
+int cmd_query(const std::string& dir, int argc, char** argv)
+{
+  bool has_chip = false, has_cycles = false, has_segment = false, summary = false;
+  uint64_t chip = 0;
+  uint32_t cycles = 0;
+  uint16_t segment = 0;
+  std::vector<unsigned> fields;
+
+  for (int i = 0; i < argc; i++) {
+    std::string a = argv[i];
+    const char* v = i + 1 < argc ? argv[i + 1] : nullptr;
+    if (a == "--summary") {
+      summary = true;
+      continue;
+    }
+    if (!v) {
+      fprintf(stderr, "rstore: %s needs a value\n", a.c_str());
+      return 2;
+    }
+    i++;
+    if (a == "--chip") {
+      chip = strtoull(v, nullptr, 16);
+      has_chip = true;
+    } else if (a == "--cycles") {
+      cycles = strtoul(v, nullptr, 0);
+      has_cycles = true;
+    } else if (a == "--segment") {
+      segment = (uint16_t)strtoul(v, nullptr, 0);
+      has_segment = true;
+    } else if (a == "--field") {
+      unsigned f = 0;
+      while (f < FS_N_FIELDS && std::string(FS_FIELDS[f]) != v)
+        f++;
+      if (f == FS_N_FIELDS) {
+        fprintf(stderr, "rstore: unknown field %s\n", v);
+        return 2;
+      }
+      fields.push_back(f);
+    } else {
+      fprintf(stderr, "rstore: unknown option %s\n", a.c_str());
+      return 2;
+    }
+  }
+  if (fields.empty())
+    for (unsigned f = 0; f < FS_N_FIELDS; f++)
+      fields.push_back(f);
+
+  auto start = std::chrono::steady_clock::now();
+  Store store(dir);
+  if (!store.open_read())
+    return 1;
+
+  size_t matched = 0;
+  std::vector<double> sum(FS_N_FIELDS, 0);
+  std::vector<uint16_t> lo(FS_N_FIELDS, 0xFFFF), hi(FS_N_FIELDS, 0);
+
+  if (!summary) {
+    printf("chip_id,cycles,segment");
+    for (unsigned f : fields)
+      printf(",%s", FS_FIELDS[f]);
+    printf("\n");
+  }
+
+  auto range = store.chip_range(has_chip, chip);
+  for (auto e = range.first; e != range.second; ++e) {
+    if (has_cycles && e->cycles != cycles)
+      continue;
+    uint64_t end = std::min<uint64_t>(e->first_row + e->count, store.rows());
+    for (uint64_t i = e->first_row; i < end; i++) {
+      if (has_segment && store.segment(i) != segment)
+        continue;
+      matched++;
+      if (summary) {
+        for (unsigned f : fields) {
+          uint16_t v = store.field(f, i);
+          sum[f] += v;
+          lo[f] = std::min(lo[f], v);
+          hi[f] = std::max(hi[f], v);
+        }
+        continue;
+      }
+      Row r = store.row(i);
+      printf("0x%08" PRIX64 ",%u,%u", r.chip, r.cycles, r.segment);
+      for (unsigned f : fields)
+        printf(",%u", r.field[f]);
+      printf("\n");
+    }
+  }
+
+  if (summary) {
+    printf("field,rows,min,mean,max\n");
+    for (unsigned f : fields)
+      printf("%s,%zu,%u,%.2f,%u\n", FS_FIELDS[f], matched, matched ? lo[f] : 0,
+             matched ? sum[f] / matched : 0.0, hi[f]);
+  }
+  fprintf(stderr, "rstore: %zu rows in %.2f ms\n", matched, ms_since(start));
+  return 0;
+}
+
+void usage()
+{
+  fprintf(stderr,
+          "usage: rstore ingest STORE LOG...\n"
+          "       rstore query STORE [--chip HEX] [--cycles N] [--segment S]\n"
+          "                          [--field NAME]... [--summary]\n"
+          "       rstore info STORE\n"
+          "       rstore synth STORE CHIPS\n");
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+  if (argc < 3) {
+    usage();
+    return 2;
+  }
+  std::string cmd = argv[1];
+  std::string dir = argv[2];
+
+  if (cmd == "ingest" && argc > 3)
+    return cmd_ingest(dir, argc - 3, argv + 3);
+  if (cmd == "query")
+    return cmd_query(dir, argc - 3, argv + 3);
+  if (cmd == "info")
+    return cmd_info(dir);
+  if (cmd == "synth" && argc == 4)
+    return cmd_synth(dir, (unsigned)strtoul(argv[3], nullptr, 0));
+  usage();
+  return 2;
+}
@@ -0,0 +1,462 @@
+//-------------------------------------------------------------------//
+// wear_model.cpp
+//-------------------------------------------------------------------//
+// Monte Carlo model of the flash wear experiment in main.c, used to
+// compare stress schedules and measurement settings before spending
+// board time on them.
+// Every simulated chip has a 64 x 512 byte bank. Each bit gets
+// - an endurance drawn from a Weibull distribution, past it the bit
+//    is stuck erased (reads 1)
+// - a read margin in units of the read noise sigma that shrinks with
+//    wear as  m(c) = m0 - a * (c / 1M)^beta, a read is wrong with
+//    probability Phi(-m)
+// The first word of each segment also gets per bit program and erase
+// times for the partial write/erase measurements. Worn cells program
+// faster and erase slower. Pulses add up, like on the chip.
+// At every checkpoint the measurements of src/flash_statistics.c are
+// replayed against the model:
+// - incorrect_bit_count: majority of STAT_READ_COUNT reads differs from 0
+// - unstable_bit_count: each of the STAT_READ_COUNT iterations reads
+//    the word twice and counts bits that differ between the two
+// - partial_write_latency / partial_erase_latency: the pulse delays are
+//    applied in the given order to the same word without erasing in
+//    between, stopping at the first failure, as the firmware does. A
+//    write failure at either of the first two delays is reported as
+//    FS_PARTIAL_WRITE_FAIL, later failures keep the last passing delay.
+// Chips run in parallel, results only depend on --seed, not on the
+// thread count.
+//-------------------------------------------------------------------//
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <getopt.h>
+
+namespace {
+
+// must match src/flash_operations.h and src/flash_statistics.h
+constexpr unsigned F_BANK_N_SEGMENTS = 64;
+constexpr unsigned F_SEGMENT_N_BITS = 512 * 8;
+constexpr unsigned FS_PARTIAL_WRITE_FAIL = 0xFFFF;
+constexpr unsigned FS_PARTIAL_ERASE_FAIL = 0xFFFF;
+
+// same fields as fs_stats_s, the ones the firmware never fills are left out
+struct SegmentStats {
+  uint32_t incorrect_bit_count;
+  uint32_t unstable_bit_count;
+  uint32_t partial_write_latency;
+  uint32_t partial_erase_latency;
+};
+
+struct Options {
+  unsigned chips = 1000;
+  unsigned threads = 0;
+  uint64_t seed = 1;
+  uint32_t total_cycles = 2000000;     // TOTAL_PE_CYCLES
+  uint32_t increment_cycles = 200000;  // STAT_INCREMENT_CYCLES
+  unsigned reads = 11;                 // STAT_READ_COUNT
+  std::vector<unsigned> write_delays = {12, 10, 8, 6, 4, 0}; // NOPs
+  std::vector<unsigned> erase_delays = {12, 10, 8, 6, 4, 2}; // TA1 ticks
+  const char* per_chip_csv = nullptr;
+
+  // endurance
+  double weibull_shape = 2.0;
+  double weibull_scale = 2.0e7;
+  // read margin in read noise sigmas
+  double margin_mean = 12.0;
+  double margin_sd = 1.0;
+  double wear_rate_median = 3.0; // margin lost at 1M cycles
+  double wear_rate_log_sd = 0.5;
+  double wear_exponent = 0.7;
+  // partial operations, in timer ticks (~1 us)
+  double program_time_median = 6.0;
+  double program_time_log_sd = 0.3;
+  double program_wear_gain = 0.2;
+  double erase_time_median = 15000.0;
+  double erase_time_log_sd = 0.2;
+  double erase_wear_gain = 0.5;
+  double write_pulse_offset = 3.0;
+  double erase_pulse_offset = 5.0;
+  unsigned write_overhead = 30; // timer ticks around the NOPs
+  unsigned erase_overhead = 10;
+};
+
+// every chip draws from its own stream, so results do not depend on which
+// thread simulated it
+inline uint64_t splitmix64(uint64_t x)
+{
+  x += 0x9E3779B97F4A7C15ull;
+  x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+  x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+  return x ^ (x >> 31);
+}
+
+inline double to_unit(uint64_t x)
+{
+  return ((x >> 11) + 0.5) * (1.0 / 9007199254740992.0); // (0, 1)
+}
+
+class Rng {
+public:
+  explicit Rng(uint64_t seed) : state_(seed) {}
+
+  uint64_t next()
+  {
+    state_ += 0x9E3779B97F4A7C15ull;
+    return splitmix64(state_);
+  }
+
+  double uniform() { return to_unit(next()); }
+
+  double normal()
+  {
+    double u1 = uniform();
+    double u2 = uniform();
+    return std::sqrt(-2.0 * std::log(u1)) * std::cos(6.283185307179586 * u2);
+  }
+
+private:
+  uint64_t state_;
+};
+
+struct BitModel {
+  float endurance;
+  float margin;
+  float wear_rate;
+};
+
+struct WordModel {
+  float program_time[16];
+  float erase_time[16];
+};
+
+class Chip {
+public:
+  Chip(const Options& opt, unsigned index)
+    : opt_(opt), bits_(F_BANK_N_SEGMENTS * F_SEGMENT_N_BITS), words_(F_BANK_N_SEGMENTS),
+      rng_(splitmix64(opt.seed ^ (0xC0FFEEull * (index + 1))))
+  {
+    for (auto& b : bits_) {
+      double u = rng_.uniform();
+      b.endurance = (float)(opt.weibull_scale * std::pow(-std::log(u), 1.0 / opt.weibull_shape));
+      b.margin = (float)(opt.margin_mean + opt.margin_sd * rng_.normal());
+      b.wear_rate = (float)(opt.wear_rate_median * std::exp(opt.wear_rate_log_sd * rng_.normal()));
+    }
+    for (auto& w : words_) {
+      for (unsigned b = 0; b < 16; b++) {
+        w.program_time[b] = (float)(opt.program_time_median *
+                                    std::exp(opt.program_time_log_sd * rng_.normal()));
+        w.erase_time[b] = (float)(opt.erase_time_median *
+                                  std::exp(opt.erase_time_log_sd * rng_.normal()));
+      }
+    }
+  }
+
+  void measure(uint32_t cycles, SegmentStats* out)
+  {
+    double wear = std::pow(cycles / 1.0e6, opt_.wear_exponent);
+
+    for (unsigned s = 0; s < F_BANK_N_SEGMENTS; s++) {
+      SegmentStats& st = out[s];
+      st.incorrect_bit_count = 0;
+      st.unstable_bit_count = 0;
+
+      const BitModel* seg = &bits_[s * F_SEGMENT_N_BITS];
+      for (unsigned i = 0; i < F_SEGMENT_N_BITS; i++)
+        check_bit(seg[i], cycles, wear, st);
+
+      st.partial_write_latency = partial_write(words_[s], wear);
+      st.partial_erase_latency = partial_erase(words_[s], wear);
+    }
+  }
+
+private:
+  // fs_check_bit_values with expected_val 0
+  void check_bit(const BitModel& b, uint32_t cycles, double wear, SegmentStats& st)
+  {
+    if (cycles >= b.endurance) { // stuck erased, always reads 1
+      st.incorrect_bit_count++;
+      return;
+    }
+
+    double m = b.margin - b.wear_rate * wear;
+    if (m > 7.5) // p < 1e-13, not worth drawing for
+      return;
+    double p = 0.5 * std::erfc(m * 0.7071067811865476);
+
+    // one draw per iteration picks (first, second) out of the four outcomes
+    double both_right = (1 - p) * (1 - p);
+    double first_wrong = both_right + p * (1 - p);
+    double second_wrong = first_wrong + p * (1 - p);
+    unsigned votes = 0;
+    for (unsigned r = 0; r < opt_.reads; r++) {
+      double u = rng_.uniform();
+      if (u < both_right)
+        continue;
+      if (u < first_wrong) {
+        votes++;
+        st.unstable_bit_count++;
+      } else if (u < second_wrong) {
+        st.unstable_bit_count++;
+      } else {
+        votes++;
+      }
+    }
+    if (votes >= opt_.reads / 2 + 1)
+      st.incorrect_bit_count++;
+  }
+
+  unsigned partial_write(const WordModel& w, double wear)
+  {
+    double scale = std::exp(-opt_.program_wear_gain * wear);
+    double pulse_sum = 0;
+    unsigned latency = FS_PARTIAL_WRITE_FAIL;
+
+    for (size_t i = 0; i < opt_.write_delays.size(); i++) {
+      unsigned d = opt_.write_delays[i];
+      pulse_sum += d + opt_.write_pulse_offset;
+      for (unsigned b = 0; b < 16; b++)
+        if (w.program_time[b] * scale > pulse_sum) // firmware reports FAIL on
+          return i < 2 ? FS_PARTIAL_WRITE_FAIL : latency; // the first two steps
+      latency = d + opt_.write_overhead;
+    }
+    return latency;
+  }
+
+  unsigned partial_erase(const WordModel& w, double wear)
+  {
+    double scale = std::exp(opt_.erase_wear_gain * wear);
+    double pulse_sum = 0;
+    unsigned latency = FS_PARTIAL_ERASE_FAIL;
+
+    for (unsigned d : opt_.erase_delays) {
+      pulse_sum += d + opt_.erase_pulse_offset;
+      for (unsigned b = 0; b < 16; b++)
+        if (w.erase_time[b] * scale > pulse_sum)
+          return latency;
+      latency = d + opt_.erase_overhead;
+    }
+    return latency;
+  }
+
+  const Options& opt_;
+  std::vector<BitModel> bits_;
+  std::vector<WordModel> words_;
+  Rng rng_;
+};
+
+// bank totals of one chip at one checkpoint
+struct ChipTotals {
+  double incorrect;
+  double unstable;
+  double write_fail;
+  double erase_fail;
+};
+
+double percentile(std::vector<double> v, double q)
+{
+  if (v.empty())
+    return 0;
+  std::sort(v.begin(), v.end());
+  size_t i = (size_t)std::min<double>(v.size() - 1, std::floor(q * (v.size() - 1) + 0.5));
+  return v[i];
+}
+
+bool parse_list(const char* s, std::vector<unsigned>& out)
+{
+  out.clear();
+  while (*s) {
+    char* end;
+    unsigned long v = strtoul(s, &end, 0);
+    if (end == s)
+      return false;
+    out.push_back((unsigned)v);
+    s = *end == ',' ? end + 1 : end;
+  }
+  return !out.empty();
+}
+
+void usage()
+{
+  fprintf(stderr,
+          "usage: wear_model [options]\n"
+          "  --chips N            simulated chips (1000)\n"
+          "  --threads N          worker threads (all cores)\n"
+          "  --seed N\n"
+          "  --total N            TOTAL_PE_CYCLES (2000000)\n"
+          "  --increment N        STAT_INCREMENT_CYCLES (200000)\n"
+          "  --reads N            STAT_READ_COUNT (11)\n"
+          "  --write-delays LIST  partial write NOPs in test order (12,10,8,6,4,0)\n"
+          "  --erase-delays LIST  partial erase ticks in test order (12,10,8,6,4,2)\n"
+          "  --per-chip FILE      also write every chip/checkpoint/segment row\n"
+          "  --weibull-shape X --weibull-scale X\n"
+          "  --margin-mean X --margin-sd X\n"
+          "  --wear-rate X --wear-rate-sd X --wear-exponent X\n"
+          "Summary CSV goes to stdout, one row per checkpoint.\n");
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+  Options opt;
+  enum { CHIPS = 256, THREADS, SEED, TOTAL, INCREMENT, READS, WDELAYS, EDELAYS, PERCHIP,
+         WSHAPE, WSCALE, MMEAN, MSD, WRATE, WRATESD, WEXP };
+  static const struct option longopts[] = {
+    {"chips", required_argument, nullptr, CHIPS},
+    {"threads", required_argument, nullptr, THREADS},
+    {"seed", required_argument, nullptr, SEED},
+    {"total", required_argument, nullptr, TOTAL},
+    {"increment", required_argument, nullptr, INCREMENT},
+    {"reads", required_argument, nullptr, READS},
+    {"write-delays", required_argument, nullptr, WDELAYS},
+    {"erase-delays", required_argument, nullptr, EDELAYS},
+    {"per-chip", required_argument, nullptr, PERCHIP},
+    {"weibull-shape", required_argument, nullptr, WSHAPE},
+    {"weibull-scale", required_argument, nullptr, WSCALE},
+    {"margin-mean", required_argument, nullptr, MMEAN},
+    {"margin-sd", required_argument, nullptr, MSD},
+    {"wear-rate", required_argument, nullptr, WRATE},
+    {"wear-rate-sd", required_argument, nullptr, WRATESD},
+    {"wear-exponent", required_argument, nullptr, WEXP},
+    {"help", no_argument, nullptr, 'h'},
+    {nullptr, 0, nullptr, 0},
+  };
+
+  int c;
+  while ((c = getopt_long(argc, argv, "h", longopts, nullptr)) != -1) {
+    switch (c) {
+      case CHIPS: opt.chips = strtoul(optarg, nullptr, 0); break;
+      case THREADS: opt.threads = strtoul(optarg, nullptr, 0); break;
+      case SEED: opt.seed = strtoull(optarg, nullptr, 0); break;
+      case TOTAL: opt.total_cycles = strtoul(optarg, nullptr, 0); break;
+      case INCREMENT: opt.increment_cycles = strtoul(optarg, nullptr, 0); break;
+      case READS: opt.reads = strtoul(optarg, nullptr, 0); break;
+      case WDELAYS:
+        if (!parse_list(optarg, opt.write_delays)) { usage(); return 2; }
+        break;
+      case EDELAYS:
+        if (!parse_list(optarg, opt.erase_delays)) { usage(); return 2; }
+        break;
+      case PERCHIP: opt.per_chip_csv = optarg; break;
+      case WSHAPE: opt.weibull_shape = atof(optarg); break;
+      case WSCALE: opt.weibull_scale = atof(optarg); break;
+      case MMEAN: opt.margin_mean = atof(optarg); break;
+      case MSD: opt.margin_sd = atof(optarg); break;
+      case WRATE: opt.wear_rate_median = atof(optarg); break;
+      case WRATESD: opt.wear_rate_log_sd = atof(optarg); break;
+      case WEXP: opt.wear_exponent = atof(optarg); break;
+      default: usage(); return 2;
+    }
+  }
+  if (opt.chips == 0 || opt.increment_cycles == 0 || opt.reads == 0 ||
+      opt.weibull_shape <= 0 || opt.weibull_scale <= 0) {
+    usage();
+    return 2;
+  }
+  if (opt.threads == 0)
+    opt.threads = std::max(1u, std::thread::hardware_concurrency());
+
+  // checkpoint 0 plus one per increment, like main.c
+  std::vector<uint32_t> checkpoints = {0};
+  for (uint32_t i = 0; i < opt.total_cycles / opt.increment_cycles; i++)
+    checkpoints.push_back((i + 1) * opt.increment_cycles);
+  const size_t n_cp = checkpoints.size();
+
+  std::vector<ChipTotals> totals(opt.chips * n_cp);
+  std::vector<SegmentStats> rows;
+  if (opt.per_chip_csv)
+    rows.resize((size_t)opt.chips * n_cp * F_BANK_N_SEGMENTS);
+
+  std::atomic<unsigned> next_chip{0};
+  auto worker = [&]() {
+    std::vector<SegmentStats> seg(F_BANK_N_SEGMENTS);
+    for (unsigned chip; (chip = next_chip++) < opt.chips;) {
+      Chip model(opt, chip);
+      for (size_t cp = 0; cp < n_cp; cp++) {
+        model.measure(checkpoints[cp], seg.data());
+
+        ChipTotals& t = totals[chip * n_cp + cp];
+        t = ChipTotals{0, 0, 0, 0};
+        for (const auto& s : seg) {
+          t.incorrect += s.incorrect_bit_count;
+          t.unstable += s.unstable_bit_count;
+          t.write_fail += s.partial_write_latency == FS_PARTIAL_WRITE_FAIL;
+          t.erase_fail += s.partial_erase_latency == FS_PARTIAL_ERASE_FAIL;
+        }
+        if (!rows.empty())
+          std::copy(seg.begin(), seg.end(),
+                    rows.begin() + (chip * n_cp + cp) * F_BANK_N_SEGMENTS);
+      }
+    }
+  };
+
+  std::vector<std::thread> pool;
+  for (unsigned i = 0; i < opt.threads; i++)
+    pool.emplace_back(worker);
+  for (auto& t : pool)
+    t.join();
+
+  // detection power: share of chips whose bank total is above the 99th
+  // percentile of fresh chips
+  std::vector<double> fresh_incorrect, fresh_unstable;
+  for (unsigned chip = 0; chip < opt.chips; chip++) {
+    fresh_incorrect.push_back(totals[chip * n_cp].incorrect);
+    fresh_unstable.push_back(totals[chip * n_cp].unstable);
+  }
+  double incorrect_limit = percentile(fresh_incorrect, 0.99);
+  double unstable_limit = percentile(fresh_unstable, 0.99);
+
+  printf("cycles,incorrect_mean,incorrect_p5,incorrect_p95,unstable_mean,unstable_p5,"
+         "unstable_p95,write_fail_segments_mean,erase_fail_segments_mean,"
+         "incorrect_power,unstable_power\n");
+  for (size_t cp = 0; cp < n_cp; cp++) {
+    std::vector<double> inc, uns;
+    double wf = 0, ef = 0, inc_hits = 0, uns_hits = 0;
+    for (unsigned chip = 0; chip < opt.chips; chip++) {
+      const ChipTotals& t = totals[chip * n_cp + cp];
+      inc.push_back(t.incorrect);
+      uns.push_back(t.unstable);
+      wf += t.write_fail;
+      ef += t.erase_fail;
+      inc_hits += t.incorrect > incorrect_limit;
+      uns_hits += t.unstable > unstable_limit;
+    }
+    double inc_mean = 0, uns_mean = 0;
+    for (size_t i = 0; i < inc.size(); i++) {
+      inc_mean += inc[i];
+      uns_mean += uns[i];
+    }
+    printf("%u,%.2f,%.0f,%.0f,%.2f,%.0f,%.0f,%.2f,%.2f,%.4f,%.4f\n", checkpoints[cp],
+           inc_mean / opt.chips, percentile(inc, 0.05), percentile(inc, 0.95),
+           uns_mean / opt.chips, percentile(uns, 0.05), percentile(uns, 0.95),
+           wf / opt.chips, ef / opt.chips, inc_hits / opt.chips, uns_hits / opt.chips);
+  }
+
+  if (opt.per_chip_csv) {
+    FILE* f = fopen(opt.per_chip_csv, "w");
+    if (!f) {
+      perror(opt.per_chip_csv);
+      return 1;
+    }
+    fprintf(f, "chip,cycles,segment,incorrect_bit_count,unstable_bit_count,"
+               "partial_write_latency,partial_erase_latency\n");
+    for (unsigned chip = 0; chip < opt.chips; chip++)
+      for (size_t cp = 0; cp < n_cp; cp++)
+        for (unsigned s = 0; s < F_BANK_N_SEGMENTS; s++) {
+          const SegmentStats& r = rows[(chip * n_cp + cp) * F_BANK_N_SEGMENTS + s];
+          fprintf(f, "%u,%u,%u,%u,%u,%u,%u\n", chip, checkpoints[cp], s,
+                  r.incorrect_bit_count, r.unstable_bit_count, r.partial_write_latency,
+                  r.partial_erase_latency);
+        }
+    fclose(f);
+  }
+  return 0;
+}